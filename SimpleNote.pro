@@ -30,18 +30,44 @@ SOURCES += \
     main.cpp \
     mainwindow.cpp \
     note.cpp \
+    notebackfill.cpp \
     noteeditwidget.cpp \
+    notecache.cpp \
+    noteconnectionpool.cpp \
     notedatabase.cpp \
+    noteimagecollector.cpp \
+    noteimagestore.cpp \
+    noteitemdelegate.cpp \
+    notelistmodel.cpp \
     notelistwidget.cpp \
+    notemaintenance.cpp \
+    notemigrator.cpp \
+    notesearcher.cpp \
+    notestatementcache.cpp \
+    notetext.cpp \
+    notewriter.cpp \
     webdavconfigdialog.cpp \
     webdavsyncmanager.cpp
 
 HEADERS += \
     mainwindow.h \
     note.h \
+    notebackfill.h \
     noteeditwidget.h \
+    notecache.h \
+    noteconnectionpool.h \
     notedatabase.h \
+    noteimagecollector.h \
+    noteimagestore.h \
+    noteitemdelegate.h \
+    notelistmodel.h \
     notelistwidget.h \
+    notemaintenance.h \
+    notemigrator.h \
+    notesearcher.h \
+    notestatementcache.h \
+    notetext.h \
+    notewriter.h \
     webdavconfigdialog.h \
     webdavsyncmanager.h
 
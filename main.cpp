@@ -110,6 +110,12 @@ int main(int argc, char *argv[])
         }
     }
     
+    // 创建进程内共享的存储服务，所有窗口通过NoteDatabase::instance()访问
+    NoteDatabase database;
+    if (!database.open()) {
+        qDebug() << "无法打开数据库: " << NoteDatabase::getDatabasePath();
+    }
+    
     MainWindow w;
     w.show();
     return a.exec();
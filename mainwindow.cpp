@@ -14,6 +14,7 @@
 #include <QProcess>
 #include <QSizePolicy>
 #include <QTimer>
+#include <QEventLoop>
 #include <QDateTime>
 #include <QSqlDatabase>
 #include <QThread>
@@ -25,7 +26,7 @@ MainWindow::MainWindow(QWidget *parent)
     , ui(new Ui::MainWindow)
     , m_noteListWidget(new NoteListWidget(this))
     , m_noteEditWidget(new NoteEditWidget(nullptr)) // 保持编辑器独立，不设父窗口
-    , m_database(new NoteDatabase(this))
+    , m_database(NoteDatabase::instance())
     , m_toolBar(nullptr)
     , m_webdavSyncManager(new WebDAVSyncManager(this))
 {
@@ -145,18 +146,21 @@ void MainWindow::setupToolBar()
     // 使用icons文件夹中的自定义图标替换默认图标
     m_exportAction = new QAction(QIcon(":/icons/export.png"), "", this);
     m_importAction = new QAction(QIcon(":/icons/import.png"), "", this);
+    m_compactAction = new QAction(style()->standardIcon(QStyle::SP_DriveHDIcon), "", this);
     m_webdavConfigAction = new QAction(QIcon(":/icons/webdav.png"), "", this);
     m_syncAction = new QAction(QIcon(":/icons/sync.png"), "", this);
     
     // 设置提示文本
     m_exportAction->setToolTip("导出便签数据");
     m_importAction->setToolTip("导入便签数据");
+    m_compactAction->setToolTip("压缩数据库");
     m_webdavConfigAction->setToolTip("WebDAV云同步设置");
     m_syncAction->setToolTip("立即同步");
     
     // 添加到工具栏
     m_toolBar->addAction(m_exportAction);
     m_toolBar->addAction(m_importAction);
+    m_toolBar->addAction(m_compactAction);
     
     // 添加一个分隔符
     m_toolBar->addSeparator();
@@ -187,6 +191,7 @@ void MainWindow::setupToolBar()
     // 连接信号和槽
     connect(m_exportAction, &QAction::triggered, this, &MainWindow::exportDatabase);
     connect(m_importAction, &QAction::triggered, this, &MainWindow::importDatabase);
+    connect(m_compactAction, &QAction::triggered, this, &MainWindow::compactDatabase);
     connect(m_webdavConfigAction, &QAction::triggered, this, &MainWindow::showWebDAVConfigDialog);
     connect(m_syncAction, &QAction::triggered, this, &MainWindow::manualSync);
     
@@ -202,12 +207,18 @@ void MainWindow::setupConnections()
     // 当点击新建按钮时，创建新便签
     connect(m_noteListWidget, &NoteListWidget::createNewNote, this, &MainWindow::onCreateNewNote);
     
-    // 当默认便签保存时，刷新列表
+    // 当默认便签保存时，更新窗口映射
     connect(m_noteEditWidget, &NoteEditWidget::noteSaved, this, &MainWindow::onNoteSaved);
     
-    // 当默认便签删除时，刷新列表
+    // 当默认便签删除时，更新窗口映射
     connect(m_noteEditWidget, &NoteEditWidget::noteDeleted, this, &MainWindow::onNoteDeleted);
     
+    // 存储层提交变更后，只更新列表中受影响的行
+    connect(m_database, &NoteDatabase::notesChanged, this, &MainWindow::onNotesChanged);
+    
+    // 维护发现数据库需要压缩时在按钮提示中说明
+    connect(m_database, &NoteDatabase::maintenanceFinished, this, &MainWindow::onMaintenanceFinished);
+    
     // 当默认编辑窗口关闭时处理
     connect(m_noteEditWidget, &NoteEditWidget::closed, this, &MainWindow::onEditWindowClosed);
     
@@ -218,10 +229,10 @@ void MainWindow::setupConnections()
     connect(m_webdavSyncManager, &WebDAVSyncManager::syncError, this, &MainWindow::onSyncError);
 }
 
-void MainWindow::onNoteSelected(const Note &note)
+void MainWindow::onNoteSelected(int noteId)
 {
     // 打开或激活便签窗口
-    openOrActivateNoteWindow(note);
+    openOrActivateNoteWindow(noteId);
 }
 
 void MainWindow::onCreateNewNote()
@@ -244,8 +255,7 @@ void MainWindow::onCreateNewNote()
 
 void MainWindow::onNoteSaved(const Note &note)
 {
-    // 刷新便签列表
-    m_noteListWidget->refreshNoteList();
+    // 列表由notesChanged更新
     
     // 如果是一个新便签被保存，更新映射中的窗口引用
     // 如果便签ID从无效(-1)变为有效，需要将该窗口添加到映射
@@ -272,15 +282,26 @@ void MainWindow::onNoteDeleted(int noteId)
         // 窗口会在关闭事件中自行删除
         m_openNoteWindows.remove(noteId);
     }
+}
+
+void MainWindow::onNotesChanged(const NoteChangeBatch &changes)
+{
+    // 新增和修改的便签重新读取摘要，按更新时间移动到对应位置
+    for (int noteId : changes.insertedIds) {
+        m_noteListWidget->updateNote(noteId);
+    }
+    for (int noteId : changes.updatedIds) {
+        m_noteListWidget->updateNote(noteId);
+    }
     
-    // 刷新便签列表
-    m_noteListWidget->refreshNoteList();
+    for (int noteId : changes.deletedIds) {
+        m_noteListWidget->removeNote(noteId);
+    }
 }
 
 void MainWindow::onEditWindowClosed()
 {
-    // 默认编辑窗口关闭后刷新列表，确保所有更改都被显示
-    m_noteListWidget->refreshNoteList();
+    // 关闭时的保存提交后会通过notesChanged更新列表，这里无需刷新
 }
 
 void MainWindow::onNoteEditWindowClosed(int noteId)
@@ -291,8 +312,7 @@ void MainWindow::onNoteEditWindowClosed(int noteId)
         m_openNoteWindows.remove(noteId);
     }
     
-    // 刷新便签列表
-    m_noteListWidget->refreshNoteList();
+    // 关闭时的保存提交后会通过notesChanged更新列表，这里无需刷新
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
@@ -320,10 +340,8 @@ void MainWindow::closeEvent(QCloseEvent *event)
     event->accept();
 }
 
-void MainWindow::openOrActivateNoteWindow(const Note &note)
+void MainWindow::openOrActivateNoteWindow(int noteId)
 {
-    int noteId = note.id();
-    
     // 检查便签是否已经打开
     if (m_openNoteWindows.contains(noteId)) {
         // 如果已打开，激活对应窗口
@@ -335,6 +353,14 @@ void MainWindow::openOrActivateNoteWindow(const Note &note)
         }
     }
     
+    // 完整内容只在创建窗口时读取
+    Note note = m_database->getNote(noteId);
+    if (note.id() == -1) {
+        // 便签已不存在
+        m_noteListWidget->removeNote(noteId);
+        return;
+    }
+    
     // 创建一个新的便签编辑窗口
     NoteEditWidget *newWindow = new NoteEditWidget(nullptr); // 不设置父窗口，使其成为独立窗口
     
@@ -388,15 +414,6 @@ void MainWindow::exportDatabase()
         exportButton->setChecked(true);
     }
     
-    // 关闭数据库连接
-    m_database->close();
-    
-    // 完全移除数据库连接，确保释放文件锁定
-    QSqlDatabase::removeDatabase(QSqlDatabase::defaultConnection);
-    
-    // 等待短暂时间确保文件完全释放
-    QThread::msleep(500);
-    
     // 获取数据库目录
     QString dbDir = NoteDatabase::getDatabaseDir();
     
@@ -411,9 +428,6 @@ void MainWindow::exportDatabase()
                                                  "ZIP文件 (*.zip)");
     
     if (savePath.isEmpty()) {
-        // 重新打开数据库
-        m_database->open();
-        
         // 恢复按钮状态
         if (exportButton) {
             exportButton->setChecked(false);
@@ -439,15 +453,43 @@ void MainWindow::exportDatabase()
         // 使用Qt内置的压缩功能创建一个压缩包
         QProcess zipProcess;
         
+        // 创建临时目录用于存放要压缩的文件
+        QString tempDir = QDir::tempPath() + "/SimpleNoteTemp_" + QDateTime::currentDateTime().toString("yyyyMMddHHmmss");
+        QDir().mkpath(tempDir);
+        
+        // 导出数据库的在线快照，不必关闭数据库；快照在后台线程中复制，等待期间仍可编辑便签
+        QString snapshotPath = tempDir + "/notes.db";
+        bool snapshotOk = false;
+        QEventLoop snapshotLoop;
+        connect(m_database, &NoteDatabase::snapshotFinished, &snapshotLoop,
+                [&snapshotLoop, &snapshotOk, snapshotPath](const QString &path, bool success) {
+            if (path == snapshotPath) {
+                snapshotOk = success;
+                snapshotLoop.quit();
+            }
+        });
+        if (m_database->startSnapshot(snapshotPath)) {
+            snapshotLoop.exec();
+        }
+        
+        if (!snapshotOk) {
+            QDir(tempDir).removeRecursively();
+            progressMsg.done(0);
+            QMessageBox::warning(this, "导出失败", "无法创建数据库快照。");
+            
+            // 恢复按钮状态
+            if (exportButton) {
+                exportButton->setChecked(false);
+            }
+            return;
+        }
+    
     #ifdef Q_OS_WIN
         // Windows平台使用PowerShell的压缩命令
         // 确保同时包含数据库文件和images文件夹
         QString command = "powershell.exe";
         QStringList args;
         
-        // 创建临时目录用于存放要压缩的文件
-        QString tempDir = QDir::tempPath() + "/SimpleNoteTemp_" + QDateTime::currentDateTime().toString("yyyyMMddHHmmss");
-        
         // 备份WebDAV配置到临时目录
         bool webDAVConfigBacked = WebDAVSyncManager::backupConfig(tempDir);
         
@@ -457,11 +499,6 @@ void MainWindow::exportDatabase()
             "    # 创建临时目录\n"
             "    if (!(Test-Path -Path \"%1\")) { New-Item -Path \"%1\" -ItemType Directory -Force }\n"
             "    \n"
-            "    # 复制数据库文件到临时目录（如果存在）\n"
-            "    if (Test-Path -Path \"%2\\notes.db\") { \n"
-            "        Copy-Item -Path \"%2\\notes.db\" -Destination \"%1\\\" -Force\n"
-            "    }\n"
-            "    \n"
             "    # 复制图片文件夹到临时目录（如果存在）\n"
             "    if (Test-Path -Path \"%2\\images\") { \n"
             "        Copy-Item -Path \"%2\\images\" -Destination \"%1\\\" -Recurse -Force\n"
@@ -496,9 +533,6 @@ void MainWindow::exportDatabase()
         QString scriptPath = QDir::tempPath() + "/simplenote_export.sh";
         QFile script(scriptPath);
         
-        // 创建临时目录用于存放要压缩的文件
-        QString tempDir = QDir::tempPath() + "/SimpleNoteTemp_" + QDateTime::currentDateTime().toString("yyyyMMddHHmmss");
-        
         // 备份WebDAV配置到临时目录
         bool webDAVConfigBacked = WebDAVSyncManager::backupConfig(tempDir);
         
@@ -508,10 +542,7 @@ void MainWindow::exportDatabase()
                 << "set -e\n"  // 出错时立即退出
                 << "# 创建临时目录\n"
                 << "mkdir -p \"" << tempDir << "\"\n"
-                << "# 复制数据库文件和图片到临时目录\n"
-                << "if [ -f \"" << dbDir << "/notes.db\" ]; then\n"
-                << "    cp \"" << dbDir << "/notes.db\" \"" << tempDir << "/\"\n"
-                << "fi\n"
+                << "# 复制图片到临时目录（数据库快照已在其中）\n"
                 << "if [ -d \"" << dbDir << "/images\" ]; then\n"
                 << "    cp -r \"" << dbDir << "/images\" \"" << tempDir << "/\"\n"
                 << "fi\n"
@@ -533,8 +564,7 @@ void MainWindow::exportDatabase()
             // 如果无法创建脚本文件，显示错误
             QMessageBox::warning(this, "导出失败", "无法创建临时脚本文件。");
             progressMsg.done(0);
-            // 重新打开数据库
-            m_database->open();
+            QDir(tempDir).removeRecursively();
             
             // 恢复按钮状态
             if (exportButton) {
@@ -557,9 +587,6 @@ void MainWindow::exportDatabase()
         // 关闭进度对话框
         progressMsg.done(0);
         
-        // 重新打开数据库
-        m_database->open();
-        
         // 恢复按钮状态
         if (exportButton) {
             exportButton->setChecked(false);
@@ -578,6 +605,48 @@ void MainWindow::exportDatabase()
     progressMsg.exec();
 }
 
+void MainWindow::compactDatabase()
+{
+    QMessageBox progressMsg(this);
+    progressMsg.setWindowTitle("压缩中");
+    progressMsg.setText("正在压缩数据库...\n请稍候。");
+    progressMsg.setStandardButtons(QMessageBox::NoButton);
+    progressMsg.setIcon(QMessageBox::Information);
+    
+    // 复制在后台线程中进行，完成后关闭进度对话框
+    bool success = false;
+    qint64 reclaimedBytes = 0;
+    connect(m_database, &NoteDatabase::compactionFinished, &progressMsg,
+            [&progressMsg, &success, &reclaimedBytes](bool compacted, qint64 bytes) {
+        success = compacted;
+        reclaimedBytes = bytes;
+        progressMsg.done(0);
+    });
+    
+    if (!m_database->startCompaction()) {
+        QMessageBox::warning(this, "压缩失败", "无法压缩数据库。");
+        return;
+    }
+    
+    // 显示进度对话框（会阻塞直到done被调用）
+    progressMsg.exec();
+    
+    if (success) {
+        m_compactAction->setToolTip("压缩数据库");
+        QMessageBox::information(this, "压缩完成",
+                                 QString("数据库已压缩，回收了 %1 KB。").arg(reclaimedBytes / 1024));
+    } else {
+        QMessageBox::warning(this, "压缩失败", "压缩期间便签有修改或数据库文件无法替换，请稍后重试。");
+    }
+}
+
+void MainWindow::onMaintenanceFinished(const NoteMaintenanceReport &report)
+{
+    if (report.compactionNeeded) {
+        m_compactAction->setToolTip(QString("压缩数据库（可回收约 %1 KB）").arg(report.freeBytes / 1024));
+    }
+}
+
 void MainWindow::importDatabase()
 {
     // 设置导入按钮为选中状态
@@ -591,7 +660,7 @@ void MainWindow::importDatabase()
         "导入便签数据", 
         "导入操作将覆盖当前的便签数据。导入成功后程序将自动重启。\n是否继续？",
         QMessageBox::Yes | QMessageBox::No);
-        
+    
     if (reply != QMessageBox::Yes) {
         // 恢复按钮状态
         if (importButton) {
@@ -639,7 +708,7 @@ void MainWindow::importDatabase()
     QTimer::singleShot(200, this, [this, dbDir, tempDir, importPath, appPath, appArgs, &progressMsg, importButton]() {
         bool success = false;
         QProcess unzipProcess;
-        
+    
     #ifdef Q_OS_WIN
         // Windows平台使用PowerShell的解压命令，先解压到临时目录
         QString command = "powershell.exe";
@@ -668,10 +737,7 @@ void MainWindow::importDatabase()
         
         // 检查解压是否成功
         if (unzipProcess.exitCode() == 0) {
-            // 确保数据库已完全关闭和释放
-            QSqlDatabase::removeDatabase(QSqlDatabase::defaultConnection);
-            
-            // 等待一小段时间，确保文件解锁
+            // 数据库连接已在close()中移除，等待一小段时间，确保文件解锁
             QThread::msleep(500);
             
             // 从临时目录还原WebDAV配置文件
@@ -685,6 +751,8 @@ void MainWindow::importDatabase()
                 
                 "# 删除目标位置的旧文件\n"
                 "if (Test-Path -Path \"%1\\notes.db\") { Remove-Item -Path \"%1\\notes.db\" -Force -ErrorAction SilentlyContinue }\n"
+                "# 删除旧数据库残留的WAL文件，避免被应用到新数据库上\n"
+                "Remove-Item -Path \"%1\\notes.db-wal\", \"%1\\notes.db-shm\" -Force -ErrorAction SilentlyContinue\n"
                 "if (Test-Path -Path \"%1\\images\") { Remove-Item -Path \"%1\\images\" -Recurse -Force -ErrorAction SilentlyContinue }\n"
                 
                 "# 复制新文件\n"
@@ -719,6 +787,8 @@ void MainWindow::importDatabase()
                 << "mkdir -p \"" << dbDir << "\"\n"
                 << "# 删除目标位置的旧文件\n"
                 << "rm -f \"" << dbDir << "/notes.db\"\n"
+                << "# 删除旧数据库残留的WAL文件，避免被应用到新数据库上\n"
+                << "rm -f \"" << dbDir << "/notes.db-wal\" \"" << dbDir << "/notes.db-shm\"\n"
                 << "rm -rf \"" << dbDir << "/images\"\n"
                 << "# 复制新文件\n"
                 << "if [ -f \"" << tempDir << "/notes.db\" ]; then\n"
@@ -734,10 +804,7 @@ void MainWindow::importDatabase()
             QFile::setPermissions(scriptPath, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
             args << scriptPath;
             
-            // 确保数据库已完全关闭和释放
-            QSqlDatabase::removeDatabase(QSqlDatabase::defaultConnection);
-            
-            // 等待一小段时间，确保文件解锁
+            // 数据库连接已在close()中移除，等待一小段时间，确保文件解锁
             QThread::msleep(500);
             
             // 从临时目录还原WebDAV配置文件
@@ -25,10 +25,11 @@ public:
     ~MainWindow();
 
 private slots:
-    void onNoteSelected(const Note &note);
+    void onNoteSelected(int noteId);
     void onCreateNewNote();
     void onNoteSaved(const Note &note);
     void onNoteDeleted(int noteId);
+    void onNotesChanged(const NoteChangeBatch &changes);
     void onEditWindowClosed();
     void onNoteEditWindowClosed(int noteId);
     void closeEvent(QCloseEvent *event) override;
@@ -37,6 +38,10 @@ private slots:
     void exportDatabase();
     void importDatabase();
     
+    // 压缩数据库（回收较大数据库中的空闲空间）
+    void compactDatabase();
+    void onMaintenanceFinished(const NoteMaintenanceReport &report);
+    
     // WebDAV同步功能
     void showWebDAVConfigDialog();
     void manualSync();
@@ -56,6 +61,7 @@ private:
     QToolBar *m_toolBar;
     QAction *m_exportAction;
     QAction *m_importAction;
+    QAction *m_compactAction;
     
     // WebDAV相关
     WebDAVSyncManager *m_webdavSyncManager;
@@ -69,7 +75,7 @@ private:
     void setupMessageBoxStyle();
     void setupWebDAVSync();
     
-    void openOrActivateNoteWindow(const Note &note);
+    void openOrActivateNoteWindow(int noteId);
     void closeAllNoteWindows();
 };
 #endif // MAINWINDOW_H
@@ -81,4 +81,53 @@ Note Note::fromVariant(const QVariant &variant)
         map["createTime"].toDateTime(),
         map["updateTime"].toDateTime()
     );
-} 
\ No newline at end of file
+} 
+
+bool NoteChangeBatch::isEmpty() const
+{
+    return insertedIds.isEmpty() && updatedIds.isEmpty() && deletedIds.isEmpty();
+}
+
+void NoteChangeBatch::noteInserted(int id)
+{
+    if (!insertedIds.contains(id)) {
+        insertedIds.append(id);
+    }
+}
+
+void NoteChangeBatch::noteUpdated(int id, Fields fields)
+{
+    // 同一批中新插入的便签，接收者会读取其完整状态
+    if (insertedIds.contains(id)) {
+        return;
+    }
+    
+    if (!updatedIds.contains(id)) {
+        updatedIds.append(id);
+    }
+    updatedFields[id] |= fields;
+}
+
+void NoteChangeBatch::noteDeleted(int id)
+{
+    insertedIds.removeAll(id);
+    updatedIds.removeAll(id);
+    updatedFields.remove(id);
+    
+    if (!deletedIds.contains(id)) {
+        deletedIds.append(id);
+    }
+}
+
+void NoteChangeBatch::merge(const NoteChangeBatch &other)
+{
+    for (int id : other.insertedIds) {
+        noteInserted(id);
+    }
+    for (int id : other.updatedIds) {
+        noteUpdated(id, other.updatedFields.value(id));
+    }
+    for (int id : other.deletedIds) {
+        noteDeleted(id);
+    }
+}
@@ -4,6 +4,8 @@
 #include <QString>
 #include <QDateTime>
 #include <QVariant>
+#include <QList>
+#include <QHash>
 
 class Note
 {
@@ -38,4 +40,87 @@ private:
     QDateTime m_updateTime;
 };
 
+Q_DECLARE_METATYPE(Note)
+
+// 便签摘要
+// 列表只需要标题、时间等少量信息，完整内容在打开便签窗口时再按ID读取
+struct NoteSummary
+{
+    int id = -1;
+    QString title;      // 标题，无标题便签为内容第一行（可能为空）
+    QString snippet;    // 内容摘要，搜索结果中命中的文本以HighlightBegin/HighlightEnd标记
+    QDateTime createTime;
+    QDateTime updateTime;
+    int charCount = 0;  // 字符数（不含空白）
+    int wordCount = 0;  // 字数
+    
+    static constexpr QChar HighlightBegin = QChar(0x02);
+    static constexpr QChar HighlightEnd = QChar(0x03);
+};
+
+Q_DECLARE_METATYPE(NoteSummary)
+
+// 变更日志中的一条记录
+// 序号全局单调递增，记录每个便签的插入、修改和删除（删除记录即墓碑）
+struct NoteChange
+{
+    enum Type {
+        Inserted,
+        Updated,
+        Deleted
+    };
+    
+    qint64 seq = 0;
+    int noteId = -1;
+    Type type = Updated;
+    QDateTime time;
+};
+
+// 便签列表的分页游标
+// 记录上一页最后一条的更新时间和ID，下一页从其后继续读取；默认值表示第一页
+struct NotePageCursor
+{
+    QDateTime updateTime;
+    int id = -1;
+    
+    bool isValid() const { return id != -1; }
+    
+    static NotePageCursor after(const NoteSummary &summary)
+    {
+        NotePageCursor cursor;
+        cursor.updateTime = summary.updateTime;
+        cursor.id = summary.id;
+        return cursor;
+    }
+};
+
+// 一批便签变更
+// 存储层每次提交后发出一批（写线程的一个事务、一次同步保存或批量操作），
+// 列表、其他窗口、同步等只处理自己关心的便签和字段。
+// 同一批中每个便签只出现在一个列表中：插入后又修改的记为插入，删除的只记为删除。
+struct NoteChangeBatch
+{
+    enum Field {
+        TitleField = 0x1,
+        ContentField = 0x2
+    };
+    Q_DECLARE_FLAGS(Fields, Field)
+    
+    QList<int> insertedIds;
+    QList<int> updatedIds;
+    QList<int> deletedIds;
+    QHash<int, Fields> updatedFields;  // 修改的便签中实际变化的字段，只更新了时间时为空
+    
+    bool isEmpty() const;
+    
+    void noteInserted(int id);
+    void noteUpdated(int id, Fields fields);
+    void noteDeleted(int id);
+    // 追加另一批之后发生的变更
+    void merge(const NoteChangeBatch &other);
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(NoteChangeBatch::Fields)
+Q_DECLARE_METATYPE(NoteChangeBatch)
+
 #endif // NOTE_H 
\ No newline at end of file
@@ -0,0 +1,309 @@
+#include "notebackfill.h"
+#include "notedatabase.h"
+#include "notetext.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+NoteBackfill::NoteBackfill()
+    : m_statements(nullptr)
+    , m_task(Idle)
+    , m_lastId(0)
+    , m_processed(0)
+{
+}
+
+void NoteBackfill::begin(const QSqlDatabase &db, NoteStatementCache *statements)
+{
+    m_db = db;
+    m_statements = statements;
+    m_task = TextProjection;
+    m_lastId = 0;
+    m_processed = 0;
+}
+
+bool NoteBackfill::step()
+{
+    switch (m_task) {
+    case Idle:
+        return false;
+    
+    case TextProjection:
+        // 投影必须先补齐：压缩只改写内容列，不影响投影
+        if (!projectBatch()) {
+            m_task = SearchIndex;
+            m_lastId = 0;
+        }
+        return true;
+    
+    case SearchIndex:
+        if (!indexBatch()) {
+            m_task = Compression;
+            m_lastId = 0;
+        }
+        return true;
+    
+    case Compression:
+        if (!compressBatch()) {
+            if (m_processed > 0) {
+                qDebug() << "数据补齐完成，共处理" << m_processed << "个便签";
+            }
+            cancel();
+            return false;
+        }
+        return true;
+    }
+    
+    return false;
+}
+
+void NoteBackfill::cancel()
+{
+    m_task = Idle;
+    m_db = QSqlDatabase();
+    m_statements = nullptr;
+}
+
+bool NoteBackfill::isRunning() const
+{
+    return m_task != Idle;
+}
+
+// 读取和更新在同一个写事务中进行：界面线程的同步保存不会夹在两者之间，
+// 补齐结果不会覆盖刚保存的新内容
+bool NoteBackfill::beginWrite()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec("BEGIN IMMEDIATE")) {
+        qDebug() << "数据补齐无法开始事务: " << query.lastError().text();
+        return false;
+    }
+    
+    return true;
+}
+
+bool NoteBackfill::endWrite(bool success)
+{
+    QSqlQuery query(m_db);
+    if (success && query.exec("COMMIT")) {
+        return true;
+    }
+    
+    if (success) {
+        qDebug() << "数据补齐提交失败: " << query.lastError().text();
+    }
+    query.exec("ROLLBACK");
+    return false;
+}
+
+bool NoteBackfill::projectBatch()
+{
+    if (!beginWrite()) {
+        return false;
+    }
+    
+    QSqlQuery select(m_db);
+    select.prepare("SELECT n.id, n.title, n.content, d.preamble FROM notes n "
+                   "LEFT JOIN content_dictionaries d ON d.id = n.content_dict "
+                   "WHERE n.id > ? AND (n.plain_text IS NULL OR n.first_line IS NULL OR n.search_body IS NULL) "
+                   "ORDER BY n.id LIMIT ?");
+    select.addBindValue(m_lastId);
+    select.addBindValue(BatchSize);
+    if (!select.exec()) {
+        qDebug() << "读取待补齐的便签失败: " << select.lastError().text();
+        endWrite(false);
+        return false;
+    }
+    
+    QList<QPair<int, NoteText::Projection>> rows;
+    while (select.next()) {
+        rows.append(qMakePair(select.value(0).toInt(),
+                              NoteText::project(select.value(1).toString(),
+                                                NoteDatabase::decodeContent(select.value(2),
+                                                                            select.value(3).toString()))));
+    }
+    select.finish();
+    
+    if (rows.isEmpty()) {
+        endWrite(true);
+        return false;
+    }
+    
+    QSqlQuery update(m_db);
+    update.prepare("UPDATE notes SET plain_text = ?, first_line = ?, snippet = ?, char_count = ?, "
+                   "word_count = ?, search_title = ?, search_body = ? WHERE id = ?");
+    for (const auto &row : rows) {
+        const NoteText::Projection &projection = row.second;
+        update.bindValue(0, projection.plainText);
+        update.bindValue(1, projection.firstLine);
+        update.bindValue(2, projection.snippet);
+        update.bindValue(3, projection.charCount);
+        update.bindValue(4, projection.wordCount);
+        update.bindValue(5, projection.searchTitle);
+        update.bindValue(6, projection.searchBody);
+        update.bindValue(7, row.first);
+        if (!update.exec()) {
+            qDebug() << "补齐纯文本失败: " << update.lastError().text();
+            endWrite(false);
+            return false;
+        }
+    }
+    
+    // 提交失败时这一批留到下次启动
+    m_lastId = rows.last().first;
+    if (endWrite(true)) {
+        m_processed += rows.size();
+    }
+    
+    return rows.size() == BatchSize;
+}
+
+// 进度保存在数据库中，每批与索引内容在同一个事务中提交；
+// 最后一批之后删除进度，触发器开始维护全部便签
+bool NoteBackfill::indexBatch()
+{
+    if (!beginWrite()) {
+        return false;
+    }
+    
+    QSqlQuery query(m_db);
+    if (!query.exec("SELECT name, last_id FROM search_index_backfill ORDER BY name LIMIT 1") || !query.next()) {
+        endWrite(true);
+        return false;
+    }
+    
+    QString name = query.value(0).toString();
+    int lastId = query.value(1).toInt();
+    query.finish();
+    
+    // 各索引的列与其触发器一致
+    QString columns;
+    if (name == "notes_fts") {
+        columns = "search_title, search_body";
+    } else if (name == "notes_trigram") {
+        columns = "title, plain_text";
+    }
+    
+    if (columns.isEmpty()) {
+        qDebug() << "未知的搜索索引，放弃补齐: " << name;
+        query.prepare("DELETE FROM search_index_backfill WHERE name = ?");
+        query.addBindValue(name);
+        return endWrite(query.exec());
+    }
+    
+    query.prepare("SELECT id FROM notes WHERE id > ? ORDER BY id LIMIT ?");
+    query.addBindValue(lastId);
+    query.addBindValue(BatchSize);
+    if (!query.exec()) {
+        qDebug() << "读取待加入索引的便签失败: " << query.lastError().text();
+        endWrite(false);
+        return false;
+    }
+    
+    int count = 0;
+    int upperId = lastId;
+    while (query.next()) {
+        upperId = query.value(0).toInt();
+        ++count;
+    }
+    query.finish();
+    
+    if (count > 0) {
+        query.prepare(QString("INSERT INTO %1(rowid, %2) SELECT id, %2 FROM notes WHERE id > ? AND id <= ?")
+                      .arg(name, columns));
+        query.addBindValue(lastId);
+        query.addBindValue(upperId);
+        if (!query.exec()) {
+            qDebug() << "建立搜索索引失败: " << name << query.lastError().text();
+            endWrite(false);
+            return false;
+        }
+    }
+    
+    bool finished = count < BatchSize;
+    if (finished) {
+        query.prepare("DELETE FROM search_index_backfill WHERE name = ?");
+        query.addBindValue(name);
+    } else {
+        query.prepare("UPDATE search_index_backfill SET last_id = ? WHERE name = ?");
+        query.addBindValue(upperId);
+        query.addBindValue(name);
+    }
+    if (!query.exec()) {
+        qDebug() << "更新搜索索引补齐进度失败: " << query.lastError().text();
+        endWrite(false);
+        return false;
+    }
+    
+    // 提交失败时这一批留到下次启动
+    if (!endWrite(true)) {
+        return false;
+    }
+    
+    if (finished) {
+        qDebug() << "搜索索引补齐完成: " << name;
+    }
+    
+    // 还有其他索引时继续
+    return true;
+}
+
+bool NoteBackfill::compressBatch()
+{
+    if (!beginWrite()) {
+        return false;
+    }
+    
+    QSqlQuery select(m_db);
+    select.prepare("SELECT id, content FROM notes "
+                   "WHERE id > ? AND typeof(content) = 'text' AND length(content) >= ? "
+                   "ORDER BY id LIMIT ?");
+    select.addBindValue(m_lastId);
+    select.addBindValue(NoteDatabase::CompressionThreshold);
+    select.addBindValue(BatchSize);
+    if (!select.exec()) {
+        qDebug() << "读取待压缩的便签失败: " << select.lastError().text();
+        endWrite(false);
+        return false;
+    }
+    
+    QList<QPair<int, QString>> rows;
+    while (select.next()) {
+        rows.append(qMakePair(select.value(0).toInt(), select.value(1).toString()));
+    }
+    select.finish();
+    
+    if (rows.isEmpty()) {
+        endWrite(true);
+        return false;
+    }
+    
+    // 只改写内容列，不会触发搜索索引的更新
+    QSqlQuery update(m_db);
+    update.prepare("UPDATE notes SET content = ?, content_dict = ? WHERE id = ?");
+    for (const auto &row : rows) {
+        QVariant data;
+        QVariant dictionaryId;
+        if (!NoteDatabase::encodeContent(*m_statements, row.second, data, dictionaryId)) {
+            endWrite(false);
+            return false;
+        }
+        
+        update.bindValue(0, data);
+        update.bindValue(1, dictionaryId);
+        update.bindValue(2, row.first);
+        if (!update.exec()) {
+            qDebug() << "压缩便签内容失败: " << update.lastError().text();
+            endWrite(false);
+            return false;
+        }
+    }
+    
+    // 压缩后空出的页面由数据库文件复用，文件本身在维护时变小（见NoteMaintenance）
+    m_lastId = rows.last().first;
+    if (endWrite(true)) {
+        m_processed += rows.size();
+    }
+    
+    return rows.size() == BatchSize;
+}
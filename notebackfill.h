@@ -0,0 +1,52 @@
+#ifndef NOTEBACKFILL_H
+#define NOTEBACKFILL_H
+
+#include <QSqlDatabase>
+#include "notestatementcache.h"
+
+// 数据补齐
+// 新增的列（文本投影、分词列）、新建的搜索索引和内容压缩需要为已有的便签逐行计算。
+// 便签很多时一次完成会拖慢启动，因此由写线程在启动后分批补齐：
+// 每一步处理一小批便签，在一个写事务中读取并更新，批次之间回到事件循环。
+// 是否需要补齐由数据本身判断（投影列为NULL、内容仍以TEXT保存），
+// 搜索索引按search_index_backfill中记录的进度（见NoteMigrator）；
+// 中途退出不会留下半成品，下次启动从剩下的便签继续。
+// 补齐完成前，尚未处理的便签在列表中没有摘要；索引补齐期间搜索不使用该索引，改为逐行匹配。
+class NoteBackfill
+{
+public:
+    NoteBackfill();
+    
+    // statements为同一连接的语句缓存（压缩内容时查询字典）
+    void begin(const QSqlDatabase &db, NoteStatementCache *statements);
+    // 处理一批便签，返回false表示全部补齐
+    bool step();
+    void cancel();
+    bool isRunning() const;
+
+private:
+    enum Task {
+        Idle,
+        TextProjection,  // 补齐文本投影和分词列
+        SearchIndex,     // 把已有便签加入新建的搜索索引（分词列补齐之后）
+        Compression      // 压缩以原文保存的内容
+    };
+    
+    static const int BatchSize = 50;
+    
+    // 处理一批，返回false表示该任务没有剩余的便签
+    bool projectBatch();
+    bool indexBatch();
+    bool compressBatch();
+    
+    bool beginWrite();
+    bool endWrite(bool success);
+    
+    QSqlDatabase m_db;
+    NoteStatementCache *m_statements;
+    Task m_task;
+    int m_lastId;     // 本任务已处理到的便签ID，失败的便签留到下次启动
+    int m_processed;  // 本次补齐的便签数
+};
+
+#endif // NOTEBACKFILL_H
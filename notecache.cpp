@@ -0,0 +1,64 @@
+#include "notecache.h"
+#include <QMutexLocker>
+
+NoteCache::NoteCache(qint64 maxBytes)
+    : m_notes(maxBytes)
+    , m_generation(0)
+{
+}
+
+bool NoteCache::lookup(int id, Note &note)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    // object()会把命中的便签移到最近使用的位置
+    Note *cached = m_notes.object(id);
+    if (!cached) {
+        return false;
+    }
+    
+    note = *cached;
+    return true;
+}
+
+quint64 NoteCache::generation()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_generation;
+}
+
+void NoteCache::insert(const Note &note, quint64 generation)
+{
+    if (note.id() <= 0) {
+        return;
+    }
+    
+    QMutexLocker locker(&m_mutex);
+    
+    // 读取期间有便签被保存或删除，读到的可能已是旧内容
+    if (generation != m_generation) {
+        return;
+    }
+    
+    // 超过上限的单个便签不缓存，QCache会直接丢弃
+    m_notes.insert(note.id(), new Note(note), costOf(note));
+}
+
+void NoteCache::invalidate(int id)
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_generation;
+    m_notes.remove(id);
+}
+
+void NoteCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_generation;
+    m_notes.clear();
+}
+
+qint64 NoteCache::costOf(const Note &note)
+{
+    return qint64(sizeof(Note)) + qint64(note.title().size() + note.content().size()) * qint64(sizeof(QChar));
+}
@@ -0,0 +1,42 @@
+#ifndef NOTECACHE_H
+#define NOTECACHE_H
+
+#include <QCache>
+#include <QMutex>
+#include "note.h"
+
+// 便签缓存
+// 保存最近读取的已解码便签（内容已解压并拼回文档头），按占用字节数限制大小，
+// 超出上限时淘汰最久未使用的便签。重新打开刚关闭的便签窗口时不必再读库和解压。
+// 可在任意线程使用。保存、删除便签后必须调用invalidate()；
+// 为避免读取与写入交错时缓存旧内容，读取前先取generation()，插入时带上该值，
+// 期间发生过失效的读取结果不会进入缓存。
+class NoteCache
+{
+public:
+    explicit NoteCache(qint64 maxBytes = DefaultMaxBytes);
+    
+    // 命中时复制到note并返回true
+    bool lookup(int id, Note &note);
+    
+    quint64 generation();
+    void insert(const Note &note, quint64 generation);
+    
+    void invalidate(int id);
+    void clear();
+    
+    // 默认上限16MB
+    static const qint64 DefaultMaxBytes = 16 * 1024 * 1024;
+
+private:
+    Q_DISABLE_COPY(NoteCache)
+    
+    // 便签大致占用的字节数
+    static qint64 costOf(const Note &note);
+    
+    QMutex m_mutex;
+    QCache<int, Note> m_notes;
+    quint64 m_generation;
+};
+
+#endif // NOTECACHE_H
@@ -0,0 +1,297 @@
+#include "noteconnectionpool.h"
+#include "notedatabase.h"
+#include <QAtomicInt>
+#include <QDeadlineTimer>
+#include <QMutexLocker>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QThread>
+#include <QDebug>
+
+namespace {
+// 读连接名称的序号，进程内唯一
+QAtomicInt s_nextConnectionId(1);
+}
+
+// 一个线程的读连接，只在所属线程中打开和关闭
+struct NoteConnectionPool::Connection
+{
+    QString name;
+    QSqlDatabase db;
+    NoteStatementCache statements;
+    QThread *thread = nullptr;
+    QObject *context = nullptr;     // 属于所属线程，用于把关闭请求投递到该线程
+    // 以下两项由State::mutex保护
+    bool closeRequested = false;
+    bool isOpen = false;
+    
+    void close()
+    {
+        statements.clear();
+        if (db.isOpen()) {
+            db.close();
+        }
+    }
+};
+
+// 连接池的共享状态，线程结束时可能晚于连接池本身
+struct NoteConnectionPool::State
+{
+    QMutex mutex;
+    QWaitCondition idle;
+    QList<QSharedPointer<Connection>> connections;
+    int activeLeases = 0;
+    bool open = false;
+    QWaitCondition closed;  // 有读连接在所属线程中关闭
+};
+
+// 线程本地数据，由QThreadStorage在线程结束时删除
+struct NoteConnectionPool::ThreadHandle
+{
+    QSharedPointer<Connection> connection;
+    QWeakPointer<State> state;
+    int depth = 0;
+    
+    ~ThreadHandle()
+    {
+        if (!connection) {
+            return;
+        }
+        
+        if (QSharedPointer<State> shared = state.toStrongRef()) {
+            QMutexLocker locker(&shared->mutex);
+            shared->connections.removeOne(connection);
+        }
+        
+        // 在所属线程中关闭并移除连接
+        QString name = connection->name;
+        connection->close();
+        connection->db = QSqlDatabase();
+        delete connection->context;
+        connection->context = nullptr;
+        
+        if (QSharedPointer<State> shared = state.toStrongRef()) {
+            QMutexLocker locker(&shared->mutex);
+            connection->isOpen = false;
+            shared->closed.wakeAll();
+        }
+        
+        connection.reset();
+        QSqlDatabase::removeDatabase(name);
+    }
+};
+
+NoteConnectionPool::NoteConnectionPool(const QString &dbPath, int maxReaders)
+    : m_dbPath(dbPath)
+    , m_mainStatements(nullptr)
+    , m_mainThread(nullptr)
+    , m_state(new State)
+    , m_readerSlots(maxReaders)
+{
+}
+
+NoteConnectionPool::~NoteConnectionPool()
+{
+    // 仍在运行的线程结束时再移除各自的连接
+    close();
+}
+
+void NoteConnectionPool::setMainConnection(NoteStatementCache *statements, QThread *thread)
+{
+    m_mainStatements = statements;
+    m_mainThread = thread;
+}
+
+void NoteConnectionPool::open()
+{
+    QMutexLocker locker(&m_state->mutex);
+    m_state->open = true;
+}
+
+void NoteConnectionPool::close()
+{
+    QMutexLocker locker(&m_state->mutex);
+    m_state->open = false;
+    
+    // 等待正在进行的读取结束，之后的读取会直接失败
+    while (m_state->activeLeases > 0) {
+        m_state->idle.wait(&m_state->mutex);
+    }
+    
+    // 请求各线程关闭自己的读连接，当前线程的连接直接关闭
+    QList<QSharedPointer<Connection>> pending;
+    for (const QSharedPointer<Connection> &connection : m_state->connections) {
+        if (!connection->isOpen) {
+            continue;
+        }
+        
+        connection->closeRequested = true;
+        if (connection->thread == QThread::currentThread()) {
+            connection->close();
+            connection->isOpen = false;
+            connection->closeRequested = false;
+        } else {
+            pending.append(connection);
+        }
+    }
+    
+    QSharedPointer<State> state = m_state;
+    for (const QSharedPointer<Connection> &connection : pending) {
+        QMetaObject::invokeMethod(connection->context, [state, connection]() {
+            handleCloseRequest(state, connection);
+        }, Qt::QueuedConnection);
+    }
+    
+    // 等待连接关闭以释放数据库文件（导入会替换它）；线程无法及时处理请求时不再等待
+    QDeadlineTimer deadline(CloseTimeoutMs);
+    for (const QSharedPointer<Connection> &connection : pending) {
+        while (connection->isOpen) {
+            if (!m_state->closed.wait(&m_state->mutex, deadline)) {
+                qDebug() << "读连接未能及时关闭: " << connection->name;
+                return;
+            }
+        }
+    }
+}
+
+// 在连接所属线程中执行关闭请求
+// 处理前连接池已重新打开时保留请求，由该线程下次读取时关闭后重连（数据库文件可能已被替换）
+void NoteConnectionPool::handleCloseRequest(const QSharedPointer<State> &state, const QSharedPointer<Connection> &connection)
+{
+    QMutexLocker locker(&state->mutex);
+    if (!connection->closeRequested || state->open) {
+        return;
+    }
+    
+    connection->close();
+    connection->isOpen = false;
+    connection->closeRequested = false;
+    state->closed.wakeAll();
+}
+
+NoteStatementCache *NoteConnectionPool::acquire()
+{
+    ThreadHandle *handle = m_handles.localData();
+    
+    // 同一线程嵌套读取，沿用已持有的连接
+    if (handle && handle->depth > 0) {
+        ++handle->depth;
+        return &handle->connection->statements;
+    }
+    
+    {
+        QMutexLocker locker(&m_state->mutex);
+        if (!m_state->open) {
+            return nullptr;
+        }
+        ++m_state->activeLeases;
+    }
+    
+    m_readerSlots.acquire();
+    
+    if (!handle) {
+        handle = new ThreadHandle;
+        handle->state = m_state;
+        m_handles.setLocalData(handle);
+    }
+    
+    if (!handle->connection) {
+        handle->connection = QSharedPointer<Connection>::create();
+        handle->connection->name = QString("SimpleNote.reader.%1").arg(s_nextConnectionId.fetchAndAddRelaxed(1));
+        handle->connection->db = QSqlDatabase::addDatabase("QSQLITE", handle->connection->name);
+        handle->connection->db.setDatabaseName(m_dbPath);
+        handle->connection->thread = QThread::currentThread();
+        handle->connection->context = new QObject;
+        
+        QMutexLocker locker(&m_state->mutex);
+        m_state->connections.append(handle->connection);
+    }
+    
+    Connection &connection = *handle->connection;
+    {
+        // 关闭请求尚未在事件循环中处理（或线程没有事件循环），先关闭再重新打开
+        QMutexLocker locker(&m_state->mutex);
+        if (connection.closeRequested) {
+            connection.close();
+            connection.isOpen = false;
+            connection.closeRequested = false;
+            m_state->closed.wakeAll();
+        }
+    }
+    
+    if (!connection.db.isOpen()) {
+        bool opened = openConnection(connection);
+        
+        QMutexLocker locker(&m_state->mutex);
+        connection.isOpen = opened;
+        if (!opened) {
+            locker.unlock();
+            handle->depth = 1;
+            release();
+            return nullptr;
+        }
+    }
+    
+    handle->depth = 1;
+    return &handle->connection->statements;
+}
+
+void NoteConnectionPool::release()
+{
+    ThreadHandle *handle = m_handles.localData();
+    if (--handle->depth > 0) {
+        return;
+    }
+    
+    m_readerSlots.release();
+    
+    QMutexLocker locker(&m_state->mutex);
+    if (--m_state->activeLeases == 0) {
+        m_state->idle.wakeAll();
+    }
+}
+
+bool NoteConnectionPool::openConnection(Connection &connection)
+{
+    if (!connection.db.open()) {
+        qDebug() << "无法打开读连接: " << connection.db.lastError().text();
+        return false;
+    }
+    
+    connection.statements.setDatabase(connection.db);
+    
+    if (!NoteDatabase::applyStorageProfile(connection.db)) {
+        connection.close();
+        return false;
+    }
+    
+    // 读连接只用于查询，误写会直接报错
+    QSqlQuery query(connection.db);
+    if (!query.exec("PRAGMA query_only = 1")) {
+        qDebug() << "设置只读连接失败: " << query.lastError().text();
+    }
+    
+    return true;
+}
+
+NoteConnectionPool::Lease::Lease(NoteConnectionPool *pool)
+    : m_pool(pool)
+    , m_statements(nullptr)
+    , m_acquired(false)
+{
+    // 主连接所在线程直接使用主连接
+    if (QThread::currentThread() == pool->m_mainThread) {
+        m_statements = pool->m_mainStatements;
+        return;
+    }
+    
+    m_statements = pool->acquire();
+    m_acquired = m_statements != nullptr;
+}
+
+NoteConnectionPool::Lease::~Lease()
+{
+    if (m_acquired) {
+        m_pool->release();
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef NOTECONNECTIONPOOL_H
+#define NOTECONNECTIONPOOL_H
+
+#include <QList>
+#include <QMutex>
+#include <QSemaphore>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+#include <QThreadStorage>
+#include <QWaitCondition>
+#include "notestatementcache.h"
+
+class QThread;
+
+// 读连接池
+// Qt的数据库连接只能在创建它的线程中使用，因此后台线程（搜索、同步、维护等）
+// 各自使用一个命名读连接，连接在线程首次读取时创建，线程结束时释放。
+// 主连接所在的线程直接使用主连接，写入仍然只经过主连接和写线程。
+// WAL模式下读连接之间、读连接与写连接之间互不阻塞；
+// 同时读取的线程数不超过maxReaders，超出的线程等待空闲名额。
+class NoteConnectionPool
+{
+public:
+    explicit NoteConnectionPool(const QString &dbPath, int maxReaders = DefaultMaxReaders);
+    ~NoteConnectionPool();
+    
+    // 登记主连接的语句缓存及其所属线程
+    void setMainConnection(NoteStatementCache *statements, QThread *thread);
+    
+    // 打开连接池后才允许读取；关闭时等待正在进行的读取结束，再请求各线程关闭自己的读连接
+    // Qt的连接只能在所属线程中关闭：有事件循环的线程随即关闭，close()最多等待CloseTimeoutMs；
+    // 其他线程在下次读取或线程结束时关闭。重新打开后在所属线程中按需重连
+    void open();
+    void close();
+    
+    // 读取租约：作用域内持有当前线程的读连接，同一线程可以嵌套
+    class Lease
+    {
+    public:
+        explicit Lease(NoteConnectionPool *pool);
+        ~Lease();
+        
+        // 当前线程可用的语句缓存，连接池已关闭或连接无法打开时为nullptr
+        NoteStatementCache *statements() const { return m_statements; }
+    
+    private:
+        Q_DISABLE_COPY(Lease)
+        
+        NoteConnectionPool *m_pool;
+        NoteStatementCache *m_statements;
+        bool m_acquired;
+    };
+    
+    static const int DefaultMaxReaders = 4;
+    // 关闭时等待各线程关闭读连接的最长时间
+    static const int CloseTimeoutMs = 2000;
+
+private:
+    Q_DISABLE_COPY(NoteConnectionPool)
+    
+    struct Connection;
+    struct State;
+    struct ThreadHandle;
+    
+    NoteStatementCache *acquire();
+    void release();
+    bool openConnection(Connection &connection);
+    static void handleCloseRequest(const QSharedPointer<State> &state, const QSharedPointer<Connection> &connection);
+    
+    QString m_dbPath;
+    NoteStatementCache *m_mainStatements;
+    QThread *m_mainThread;
+    QSharedPointer<State> m_state;   // 线程结束时通过弱引用注销连接
+    QSemaphore m_readerSlots;
+    QThreadStorage<ThreadHandle*> m_handles;
+};
+
+#endif // NOTECONNECTIONPOOL_H
@@ -1,10 +1,116 @@
 #include "notedatabase.h"
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
 #include <QDateTime>
 #include <QStandardPaths>
+#include <QThread>
+#include <QCoreApplication>
+#include <QSet>
+#include <memory>
+#include "notewriter.h"
+#include "notetext.h"
+#include "noteimagestore.h"
+#include "noteimagecollector.h"
+#include "noteconnectionpool.h"
+#include "notemigrator.h"
+
+namespace {
+// 便签表的常用语句，通过NoteStatementCache在每个连接上只准备一次
+const QString SqlInsertNote = QStringLiteral(
+    "INSERT INTO notes (title, content, content_dict, plain_text, first_line, snippet, char_count, word_count, "
+    "search_title, search_body, create_time, update_time) "
+    "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+const QString SqlUpdateNote = QStringLiteral(
+    "UPDATE notes SET title = ?, content = ?, content_dict = ?, plain_text = ?, first_line = ?, snippet = ?, "
+    "char_count = ?, word_count = ?, search_title = ?, search_body = ?, update_time = ? WHERE id = ?");
+const QString SqlSelectStoredNote = QStringLiteral(
+    "SELECT title, content FROM notes WHERE id = ?");
+const QString SqlDeleteNote = QStringLiteral(
+    "DELETE FROM notes WHERE id = ?");
+const QString SqlSelectNote = QStringLiteral(
+    "SELECT n.id, n.title, n.content, n.create_time, n.update_time, d.preamble "
+    "FROM notes n LEFT JOIN content_dictionaries d ON d.id = n.content_dict WHERE n.id = ?");
+
+// 内容压缩
+// Qt生成的HTML开头是固定的文档头和样式表（到<body>标签为止），每个便签都重复一份。
+// 文档头按原文存入字典表content_dictionaries，便签只记录字典编号；其余部分用zlib压缩后以BLOB保存。
+// 以TEXT保存的内容是未压缩的原文（旧版本写入的或内容过短），读取时按存储类型区分。
+const QString SqlSelectDictionary = QStringLiteral(
+    "SELECT id FROM content_dictionaries WHERE preamble = ?");
+const QString SqlInsertDictionary = QStringLiteral(
+    "INSERT OR IGNORE INTO content_dictionaries (preamble) VALUES (?)");
+
+// 变更日志
+const QString SqlSelectChangesSince = QStringLiteral(
+    "SELECT seq, note_id, change_type, change_time FROM note_changes "
+    "WHERE seq > ? ORDER BY seq LIMIT ?");
+const QString SqlSelectLatestChangeSeq = QStringLiteral(
+    "SELECT COALESCE(MAX(seq), 0) FROM note_changes");
+
+// 便签对图片的引用，每次保存时按内容重新登记
+const QString SqlDeleteImageRefs = QStringLiteral(
+    "DELETE FROM image_refs WHERE note_id = ?");
+const QString SqlInsertImageRef = QStringLiteral(
+    "INSERT OR IGNORE INTO image_refs (note_id, hash) VALUES (?, ?)");
+
+// 摘要查询只读取保存时计算好的第一行、摘要和字数，不读取完整内容
+// 分页使用游标（update_time, id）而不是OFFSET，沿idx_notes_update_time索引
+// 从上一页的位置直接继续，每页的代价只与页大小有关
+const QString SqlSelectSummary = QStringLiteral(
+    "SELECT id, title, create_time, update_time, first_line, snippet, char_count, word_count "
+    "FROM notes WHERE id = ?");
+const QString SqlSelectFirstPage = QStringLiteral(
+    "SELECT id, title, create_time, update_time, first_line, snippet, char_count, word_count "
+    "FROM notes ORDER BY update_time DESC, id DESC LIMIT ?");
+const QString SqlSelectNextPage = QStringLiteral(
+    "SELECT id, title, create_time, update_time, first_line, snippet, char_count, word_count "
+    "FROM notes WHERE (update_time, id) < (?, ?) "
+    "ORDER BY update_time DESC, id DESC LIMIT ?");
+
+// 全文搜索：按BM25相关度排序（标题权重更高），另取纯文本用于生成命中摘要
+// 索引中是分词后的文本，摘要不能使用snippet()，在程序中从纯文本截取
+const QString SqlSearchFts = QStringLiteral(
+    "SELECT n.id, n.title, n.create_time, n.update_time, "
+    "n.first_line, n.snippet, n.char_count, n.word_count, n.plain_text "
+    "FROM notes_fts JOIN notes n ON n.id = notes_fts.rowid "
+    "WHERE notes_fts MATCH ? "
+    "ORDER BY bm25(notes_fts, 10.0, 1.0), n.update_time DESC LIMIT ?");
+// 子串搜索：三元组索引匹配词中间的文本，按更新时间排序
+const QString SqlSearchTrigram = QStringLiteral(
+    "SELECT n.id, n.title, n.create_time, n.update_time, "
+    "n.first_line, n.snippet, n.char_count, n.word_count, n.plain_text "
+    "FROM notes_trigram JOIN notes n ON n.id = notes_trigram.rowid "
+    "WHERE notes_trigram MATCH ? "
+    "ORDER BY n.update_time DESC LIMIT ?");
+// 子串索引无法使用时（词少于3个字符、索引不可用）逐行匹配纯文本（不再匹配HTML标签）
+const QString SqlSearchLike = QStringLiteral(
+    "SELECT id, title, create_time, update_time, "
+    "first_line, snippet, char_count, word_count, plain_text "
+    "FROM notes WHERE title LIKE ? OR plain_text LIKE ? ORDER BY update_time DESC LIMIT ?");
+
+// 新建的搜索索引尚在补齐中（见NoteBackfill），只包含部分便签
+const QString SqlSelectIndexBackfill = QStringLiteral(
+    "SELECT 1 FROM search_index_backfill WHERE name = ?");
+
+// 搜索结果的最大数量
+const int SearchResultLimit = 500;
+// 分批返回搜索结果时每批的数量，第一批尽快显示
+const int SearchBatchSize = 25;
+}
+
+const char *const NoteDatabase::MainConnectionName = "SimpleNote.main";
+NoteDatabase *NoteDatabase::s_instance = nullptr;
+
+// 获取进程内共享的存储服务实例
+NoteDatabase *NoteDatabase::instance()
+{
+    Q_ASSERT_X(s_instance, "NoteDatabase::instance", "存储服务尚未在main()中创建");
+    return s_instance;
+}
 
 // 获取数据库存储目录的静态方法
 QString NoteDatabase::getDatabaseDir()
@@ -20,8 +126,21 @@ QString NoteDatabase::getDatabasePath()
     return getDatabaseDir() + "/notes.db";
 }
 
-NoteDatabase::NoteDatabase(QObject *parent) : QObject(parent), m_isOpen(false)
+NoteDatabase::NoteDatabase(QObject *parent)
+    : QObject(parent)
+    , m_writer(nullptr)
+    , m_writerThread(nullptr)
+    , m_imageCollector(nullptr)
+    , m_imageCollectorThread(nullptr)
+    , m_readers(nullptr)
+    , m_isOpen(false)
+    , m_hasFts(false)
+    , m_hasTrigram(false)
 {
+    qRegisterMetaType<Note>("Note");
+    qRegisterMetaType<NoteMaintenanceReport>("NoteMaintenanceReport");
+    qRegisterMetaType<NoteChangeBatch>("NoteChangeBatch");
+    
     // 获取并创建应用程序数据目录
     QString dataDir = getDatabaseDir();
     QDir dir(dataDir);
@@ -33,15 +152,22 @@ NoteDatabase::NoteDatabase(QObject *parent) : QObject(parent), m_isOpen(false)
     m_dbPath = getDatabasePath();
     qDebug() << "数据库路径：" << m_dbPath;
     
-    // 注册数据库连接
-    m_db = QSqlDatabase::addDatabase("QSQLITE");
-    m_db.setDatabaseName(m_dbPath);
+    // 后台线程的读连接，本线程的读取直接使用主连接
+    m_readers = new NoteConnectionPool(m_dbPath);
+    m_readers->setMainConnection(&m_statements, thread());
+    
+    // 注册为共享实例，连接在open()中按需注册
+    Q_ASSERT(!s_instance);
+    s_instance = this;
 }
 
 NoteDatabase::~NoteDatabase()
 {
-    if (m_isOpen) {
-        close();
+    close();
+    delete m_readers;
+    
+    if (s_instance == this) {
+        s_instance = nullptr;
     }
 }
 
@@ -51,12 +177,28 @@ bool NoteDatabase::open()
         return true;
     }
     
+    // 注册命名连接，连接由本实例独占
+    if (!QSqlDatabase::contains(MainConnectionName)) {
+        m_db = QSqlDatabase::addDatabase("QSQLITE", MainConnectionName);
+        m_db.setDatabaseName(m_dbPath);
+    }
+    
     if (!m_db.open()) {
         qDebug() << "无法打开数据库: " << m_db.lastError().text();
         return false;
     }
     
     m_isOpen = true;
+    m_statements.setDatabase(m_db);
+    
+    // 新库直接使用增量回收模式；已有的库由写线程在空闲维护时切换（见NoteMaintenance）
+    NoteMaintenance::prepareNewDatabase(m_db);
+    
+    // 应用存储配置（WAL等），必须在建表前完成
+    if (!applyStorageProfile(m_db)) {
+        close();
+        return false;
+    }
     
     // 初始化数据库表
     if (!createTables()) {
@@ -64,15 +206,115 @@ bool NoteDatabase::open()
         return false;
     }
     
+    // 启动写线程和图片回收，表结构已就绪
+    startWriter();
+    startImageCollector();
+    m_readers->open();
+    
     return true;
 }
 
+void NoteDatabase::startWriter()
+{
+    m_writerThread = new QThread(this);
+    m_writerThread->setObjectName("NoteWriter");
+    
+    m_writer = new NoteWriter(m_dbPath);
+    m_writer->moveToThread(m_writerThread);
+    connect(m_writerThread, &QThread::finished, m_writer, &QObject::deleteLater);
+    
+    // 写线程的结果以排队方式回到本对象所在线程再转发
+    // 接收者处理完通知后新便签已拿到ID，写线程不再需要按请求编号合并
+    connect(m_writer, &NoteWriter::saveFinished, this, [this](quint64 requestId, const Note &note, bool success) {
+        emit noteSaveFinished(requestId, note, success);
+        if (m_writer) {
+            m_writer->forgetInsert(requestId);
+        }
+    });
+    connect(m_writer, &NoteWriter::maintenanceFinished, this, &NoteDatabase::maintenanceFinished);
+    connect(m_writer, &NoteWriter::notesChanged, this, &NoteDatabase::notesChanged);
+    
+    // 缓存在写线程提交后立即失效，不等通知回到本线程
+    connect(m_writer, &NoteWriter::saveFinished, this, [this](quint64, const Note &note, bool) {
+        m_noteCache.invalidate(note.id());
+    }, Qt::DirectConnection);
+    
+    m_writerThread->start();
+    QMetaObject::invokeMethod(m_writer, "openConnection", Qt::BlockingQueuedConnection);
+}
+
+void NoteDatabase::stopWriter()
+{
+    if (!m_writerThread) {
+        return;
+    }
+    
+    // 写完剩余请求后关闭写连接
+    flushPendingWrites();
+    QMetaObject::invokeMethod(m_writer, "closeConnection", Qt::BlockingQueuedConnection);
+    
+    m_writerThread->quit();
+    m_writerThread->wait();
+    delete m_writerThread;
+    
+    m_writerThread = nullptr;
+    m_writer = nullptr;
+}
+
+void NoteDatabase::startImageCollector()
+{
+    m_imageCollectorThread = new QThread(this);
+    m_imageCollectorThread->setObjectName("NoteImageCollector");
+    
+    m_imageCollector = new NoteImageCollector(m_readers, m_writer);
+    m_imageCollector->moveToThread(m_imageCollectorThread);
+    connect(m_imageCollectorThread, &QThread::finished, m_imageCollector, &QObject::deleteLater);
+    
+    // 回收线程优先级较低，不与界面和写线程争抢
+    m_imageCollectorThread->start(QThread::LowPriority);
+    QMetaObject::invokeMethod(m_imageCollector, "start", Qt::QueuedConnection);
+}
+
+void NoteDatabase::stopImageCollector()
+{
+    if (!m_imageCollectorThread) {
+        return;
+    }
+    
+    // 导入、同步会替换数据库和图片目录，必须等回收完全停止
+    QMetaObject::invokeMethod(m_imageCollector, "stop", Qt::BlockingQueuedConnection);
+    
+    m_imageCollectorThread->quit();
+    m_imageCollectorThread->wait();
+    delete m_imageCollectorThread;
+    
+    m_imageCollectorThread = nullptr;
+    m_imageCollector = nullptr;
+}
+
 void NoteDatabase::close()
 {
+    // 等待后台线程的读取和快照结束并关闭读连接
+    m_readers->close();
+    waitForSnapshots();
+    stopImageCollector();
+    stopWriter();
+    
+    // 导入、同步可能替换整个数据库
+    m_noteCache.clear();
+    
     if (m_isOpen) {
+        // 先释放预编译语句，连接才能被完全移除
+        m_statements.clear();
         m_db.close();
         m_isOpen = false;
     }
+    
+    // 移除连接，确保文件锁定被完全释放（导入导出前需要）
+    if (QSqlDatabase::contains(MainConnectionName)) {
+        m_db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(MainConnectionName);
+    }
 }
 
 bool NoteDatabase::isOpen() const
@@ -80,26 +322,324 @@ bool NoteDatabase::isOpen() const
     return m_isOpen;
 }
 
-bool NoteDatabase::createTables()
+bool NoteDatabase::ensureOpen()
+{
+    if (m_isOpen) {
+        return true;
+    }
+    
+    // 只有本对象所在线程可以打开数据库，其他线程的读取直接失败
+    if (QThread::currentThread() != thread()) {
+        return false;
+    }
+    
+    return open();
+}
+
+// 存储配置
+// - journal_mode=WAL：读不阻塞写，写也不阻塞读；列表刷新、同步读取和自动保存可以并行。
+//   WAL模式持久保存在数据库文件中，其余配置只对当前连接有效。
+// - synchronous=NORMAL：WAL下只在检查点时同步磁盘，提交不再逐次fsync；
+//   断电最多丢失最近的提交，不会损坏数据库。
+// - cache_size=-8192：每个连接约8MB页缓存。
+// - mmap_size=64MB：读取直接走内存映射，减少read()调用和拷贝。
+// - temp_store=MEMORY：排序等临时数据放在内存中。
+// - busy_timeout=5000：遇到锁时最多等待5秒，而不是立即返回SQLITE_BUSY。
+// 检查点策略：
+// - wal_autocheckpoint=1000：WAL超过约1000页（4MB）时由提交的连接做被动检查点；
+// - 写线程空闲一段时间后做一次被动检查点（见NoteWriter），不等待读者，也不阻塞保存；
+// - 导出、上传不依赖检查点：VACUUM INTO在一个读事务中写出副本，已提交的内容无论在主文件
+//   还是WAL中都会包含在内，数据库保持打开（见startSnapshot）；
+// - 最后一个连接关闭时SQLite会合并并删除WAL。
+bool NoteDatabase::applyStorageProfile(QSqlDatabase &db)
+{
+    static const char *const pragmas[] = {
+        "PRAGMA busy_timeout = 5000",
+        "PRAGMA journal_mode = WAL",
+        "PRAGMA synchronous = NORMAL",
+        "PRAGMA cache_size = -8192",
+        "PRAGMA mmap_size = 67108864",
+        "PRAGMA temp_store = MEMORY",
+        "PRAGMA wal_autocheckpoint = 1000"
+    };
+    
+    QSqlQuery query(db);
+    for (const char *pragma : pragmas) {
+        if (!query.exec(QString::fromLatin1(pragma))) {
+            qDebug() << "设置存储配置失败: " << pragma << query.lastError().text();
+            return false;
+        }
+    }
+    
+    // 确认WAL已生效（网络文件系统等环境下可能退回到回滚日志）
+    if (query.exec("PRAGMA journal_mode") && query.next() &&
+        query.value(0).toString().compare("wal", Qt::CaseInsensitive) != 0) {
+        qDebug() << "WAL模式不可用，当前日志模式: " << query.value(0).toString();
+    }
+    
+    return true;
+}
+
+bool NoteDatabase::checkpoint(bool truncate)
+{
+    if (!m_isOpen) {
+        return true;
+    }
+    
+    // 先写完队列中的保存，检查点才包含全部内容
+    flushPendingWrites();
+    
+    QSqlQuery query(m_db);
+    if (!query.exec(truncate ? "PRAGMA wal_checkpoint(TRUNCATE)" : "PRAGMA wal_checkpoint(PASSIVE)")) {
+        qDebug() << "检查点失败: " << query.lastError().text();
+        return false;
+    }
+    
+    return true;
+}
+
+// 快照使用VACUUM INTO：在一个读事务中把当前数据写入新文件。
+// WAL模式下读事务不阻塞写入，快照期间的保存不会出现在快照中，也不会破坏它。
+// 复制整个数据库的耗时与文件大小成正比，因此在单独的线程中进行；
+// 该线程单独打开一个临时连接，读连接是只读的，不能执行VACUUM。
+bool NoteDatabase::startSnapshot(const QString &snapshotPath)
+{
+    return runSnapshot(snapshotPath, false, [this, snapshotPath](bool success) {
+        emit snapshotFinished(snapshotPath, success);
+    });
+}
+
+// 在快照线程中写入副本，finished在本线程中收到结果
+bool NoteDatabase::runSnapshot(const QString &snapshotPath, bool incrementalVacuum,
+                               const std::function<void(bool)> &finished)
+{
+    if (QThread::currentThread() != thread() || !ensureOpen()) {
+        return false;
+    }
+    
+    // 先写完队列中的保存，快照才包含最近的编辑
+    flushPendingWrites();
+    
+    auto success = std::make_shared<bool>(false);
+    QString dbPath = m_dbPath;
+    QThread *snapshotThread = QThread::create([dbPath, snapshotPath, incrementalVacuum, success]() {
+        *success = writeSnapshot(dbPath, snapshotPath, incrementalVacuum);
+    });
+    snapshotThread->setObjectName("NoteSnapshot");
+    snapshotThread->setParent(this);
+    m_snapshotThreads.append(snapshotThread);
+    
+    // 结果以排队方式回到本线程
+    connect(snapshotThread, &QThread::finished, this, [this, snapshotThread, success, finished]() {
+        m_snapshotThreads.removeOne(snapshotThread);
+        snapshotThread->deleteLater();
+        finished(*success);
+    });
+    
+    snapshotThread->start(QThread::LowPriority);
+    return true;
+}
+
+// 压缩：VACUUM INTO写出的副本没有空闲页，并在写出时切换为增量回收模式，
+// 之后空闲维护即可分批回收。复制在快照线程中进行，只有最后替换文件时短暂关闭数据库。
+// 副本只包含开始时的数据，复制期间有保存或删除（变更日志的序号变化）时不替换；
+// 补齐、压缩内容等内部改写按数据本身判断是否需要，替换后会重新补齐。
+bool NoteDatabase::startCompaction()
 {
-    QSqlQuery query;
+    qint64 seq = latestChangeSeq();
+    QString compactPath = m_dbPath + ".compact";
+    
+    return runSnapshot(compactPath, true, [this, compactPath, seq](bool success) {
+        qint64 reclaimedBytes = 0;
+        if (success) {
+            success = replaceWithCompacted(compactPath, seq, reclaimedBytes);
+        }
+        QFile::remove(compactPath);
+        emit compactionFinished(success, reclaimedBytes);
+    });
+}
+
+bool NoteDatabase::replaceWithCompacted(const QString &compactPath, qint64 seq, qint64 &reclaimedBytes)
+{
+    if (latestChangeSeq() != seq) {
+        qDebug() << "压缩期间便签有修改，放弃替换数据库";
+        return false;
+    }
+    
+    // 关闭后WAL已合并回主文件
+    close();
+    
+    qint64 oldSize = QFileInfo(m_dbPath).size();
+    QString oldPath = m_dbPath + ".old";
+    QFile::remove(oldPath);
+    
+    bool replaced = false;
+    if (QFile::rename(m_dbPath, oldPath)) {
+        QFile::remove(m_dbPath + "-wal");
+        QFile::remove(m_dbPath + "-shm");
+        
+        replaced = QFile::rename(compactPath, m_dbPath);
+        if (replaced) {
+            QFile::remove(oldPath);
+        } else {
+            // 替换失败，恢复原文件
+            QFile::rename(oldPath, m_dbPath);
+        }
+    }
     
-    // 创建笔记表
-    QString sql = "CREATE TABLE IF NOT EXISTS notes ("
-                  "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                  "title TEXT, "
-                  "content TEXT, "
-                  "create_time DATETIME, "
-                  "update_time DATETIME)";
+    if (!replaced) {
+        qDebug() << "无法替换数据库文件: " << m_dbPath;
+    } else {
+        reclaimedBytes = qMax<qint64>(0, oldSize - QFileInfo(m_dbPath).size());
+    }
     
-    if (!query.exec(sql)) {
-        qDebug() << "创建表失败: " << query.lastError().text();
+    return open() && replaced;
+}
+
+void NoteDatabase::waitForSnapshots()
+{
+    // 导入、同步会替换数据库文件，必须等正在进行的快照读完
+    for (QThread *snapshotThread : std::as_const(m_snapshotThreads)) {
+        snapshotThread->wait();
+    }
+}
+
+// 在快照线程中执行，incrementalVacuum为true时副本使用增量回收模式
+bool NoteDatabase::writeSnapshot(const QString &dbPath, const QString &snapshotPath, bool incrementalVacuum)
+{
+    // VACUUM INTO要求目标文件不存在
+    if (QFile::exists(snapshotPath) && !QFile::remove(snapshotPath)) {
+        qDebug() << "无法移除旧快照: " << snapshotPath;
         return false;
     }
     
+    QString connectionName = QString("SimpleNote.snapshot.%1").arg(quintptr(QThread::currentThreadId()));
+    bool success = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(dbPath);
+        
+        if (!db.open()) {
+            qDebug() << "快照无法打开数据库: " << db.lastError().text();
+        } else {
+            QSqlQuery query(db);
+            query.exec("PRAGMA busy_timeout = 5000");
+            if (incrementalVacuum) {
+                // 只作用于写出的副本，不改变原数据库
+                query.exec("PRAGMA auto_vacuum = INCREMENTAL");
+            }
+            
+            query.prepare("VACUUM INTO ?");
+            query.addBindValue(snapshotPath);
+            success = query.exec();
+            if (!success) {
+                qDebug() << "创建快照失败: " << query.lastError().text();
+            }
+            query.finish();
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    
+    if (!success) {
+        QFile::remove(snapshotPath);
+    }
+    
+    return success;
+}
+
+// 表结构由NoteMigrator按版本迁移，已有便签的数据补齐由写线程在后台完成（见NoteBackfill）
+bool NoteDatabase::createTables()
+{
+    if (!NoteMigrator::migrate(m_db)) {
+        return false;
+    }
+    
+    // 全文索引不可用时搜索退回到逐行匹配，不影响其他功能
+    m_hasFts = NoteMigrator::hasSearchIndex(m_db);
+    m_hasTrigram = NoteMigrator::hasSubstringIndex(m_db);
+    
     return true;
 }
 
+bool NoteDatabase::encodeContent(NoteStatementCache &statements, const QString &content,
+                                 QVariant &data, QVariant &dictionaryId)
+{
+    dictionaryId = QVariant();
+    
+    if (content.size() < CompressionThreshold) {
+        data = content;
+        return true;
+    }
+    
+    // 文档头到<body>标签为止
+    qsizetype preambleLength = 0;
+    qsizetype bodyPos = content.indexOf("<body");
+    if (bodyPos >= 0) {
+        qsizetype bodyEnd = content.indexOf('>', bodyPos);
+        if (bodyEnd >= 0) {
+            preambleLength = bodyEnd + 1;
+        }
+    }
+    
+    if (preambleLength > 0) {
+        QString preamble = content.left(preambleLength);
+        
+        QSqlQuery *select = statements.statement(SqlSelectDictionary);
+        if (!select) {
+            return false;
+        }
+        select->bindValue(0, preamble);
+        if (!select->exec()) {
+            qDebug() << "查询内容字典失败: " << select->lastError().text();
+            return false;
+        }
+        
+        if (select->next()) {
+            dictionaryId = select->value(0);
+        } else {
+            // 新的文档头（例如修改了默认字体），加入字典；另一个连接可能同时加入，因此忽略冲突后重新查询
+            QSqlQuery *insert = statements.statement(SqlInsertDictionary);
+            if (!insert) {
+                return false;
+            }
+            insert->bindValue(0, preamble);
+            if (!insert->exec()) {
+                qDebug() << "写入内容字典失败: " << insert->lastError().text();
+                return false;
+            }
+            
+            select = statements.statement(SqlSelectDictionary);
+            select->bindValue(0, preamble);
+            if (!select->exec() || !select->next()) {
+                qDebug() << "查询内容字典失败: " << select->lastError().text();
+                return false;
+            }
+            dictionaryId = select->value(0);
+        }
+        select->finish();
+    }
+    
+    data = qCompress(content.mid(preambleLength).toUtf8());
+    return true;
+}
+
+QString NoteDatabase::decodeContent(const QVariant &data, const QString &preamble)
+{
+    // TEXT为未压缩的原文
+    if (data.typeId() != QMetaType::QByteArray) {
+        return data.toString();
+    }
+    
+    QByteArray compressed = data.toByteArray();
+    QByteArray body = qUncompress(compressed);
+    if (body.isEmpty() && !compressed.isEmpty()) {
+        qDebug() << "解压便签内容失败";
+    }
+    
+    return preamble + QString::fromUtf8(body);
+}
+
 bool NoteDatabase::saveNote(Note &note)
 {
     if (!m_isOpen) {
@@ -108,153 +648,682 @@ bool NoteDatabase::saveNote(Note &note)
         }
     }
     
-    QSqlQuery query;
+    NoteChangeBatch changes;
+    bool success = writeNote(m_statements, note, &changes);
+    m_noteCache.invalidate(note.id());
+    
+    if (!changes.isEmpty()) {
+        emit notesChanged(changes);
+    }
+    
+    return success;
+}
+
+quint64 NoteDatabase::saveNoteAsync(const Note &note, quint64 insertRequestId)
+{
+    if (!m_isOpen) {
+        if (!open()) {
+            return 0;
+        }
+    }
+    
+    return m_writer->enqueue(note, insertRequestId);
+}
+
+void NoteDatabase::flushPendingWrites()
+{
+    // 写线程随数据库在本对象所在线程中启停，其他线程不等待，排队的保存稍后自然可见
+    if (QThread::currentThread() != thread()) {
+        return;
+    }
+    
+    if (m_writerThread && m_writerThread->isRunning()) {
+        // 阻塞等待写线程处理完队列（包括正在进行的事务）
+        QMetaObject::invokeMethod(m_writer, "processQueue", Qt::BlockingQueuedConnection);
+        
+        // 立即派发已排队的完成通知，返回后调用者即可看到新便签的ID
+        QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+    }
+}
+
+bool NoteDatabase::writeNote(NoteStatementCache &statements, Note &note, NoteChangeBatch *changes)
+{
+    // 文本投影在保存时计算，读取时不再解析HTML
+    NoteText::Projection projection = NoteText::project(note.title(), note.content());
+    
+    // 内容压缩后保存
+    QVariant contentData;
+    QVariant dictionaryId;
+    if (!encodeContent(statements, note.content(), contentData, dictionaryId)) {
+        return false;
+    }
     
     if (note.id() == -1) {
         // 新建笔记
-        query.prepare("INSERT INTO notes (title, content, create_time, update_time) "
-                     "VALUES (?, ?, ?, ?)");
-        query.addBindValue(note.title());
-        query.addBindValue(note.content());
-        query.addBindValue(note.createTime());
-        query.addBindValue(note.updateTime());
+        QSqlQuery *query = statements.statement(SqlInsertNote);
+        if (!query) {
+            return false;
+        }
         
-        if (!query.exec()) {
-            qDebug() << "保存笔记失败: " << query.lastError().text();
+        query->bindValue(0, note.title());
+        query->bindValue(1, contentData);
+        query->bindValue(2, dictionaryId);
+        query->bindValue(3, projection.plainText);
+        query->bindValue(4, projection.firstLine);
+        query->bindValue(5, projection.snippet);
+        query->bindValue(6, projection.charCount);
+        query->bindValue(7, projection.wordCount);
+        query->bindValue(8, projection.searchTitle);
+        query->bindValue(9, projection.searchBody);
+        query->bindValue(10, note.createTime());
+        query->bindValue(11, note.updateTime());
+        
+        if (!query->exec()) {
+            qDebug() << "保存笔记失败: " << query->lastError().text();
             return false;
         }
         
         // 获取新插入记录的ID
-        note.setId(query.lastInsertId().toInt());
+        note.setId(query->lastInsertId().toInt());
+        
+        if (changes) {
+            changes->noteInserted(note.id());
+        }
     } else {
         // 更新已有笔记
-        query.prepare("UPDATE notes SET title = ?, content = ?, update_time = ? "
-                     "WHERE id = ?");
-        query.addBindValue(note.title());
-        query.addBindValue(note.content());
-        query.addBindValue(QDateTime::currentDateTime());
-        query.addBindValue(note.id());
+        note.setUpdateTime(QDateTime::currentDateTime());
+        
+        // 与已保存的版本比较，通知中只标记实际变化的字段
+        // 内容按编码后的数据比较，压缩结果对相同内容是确定的
+        NoteChangeBatch::Fields fields;
+        if (changes) {
+            QSqlQuery *stored = statements.statement(SqlSelectStoredNote);
+            if (stored) {
+                stored->bindValue(0, note.id());
+                if (stored->exec() && stored->next()) {
+                    if (stored->value(0).toString() != note.title()) {
+                        fields |= NoteChangeBatch::TitleField;
+                    }
+                    QVariant storedContent = stored->value(1);
+                    if (storedContent.typeId() != contentData.typeId() || storedContent != contentData) {
+                        fields |= NoteChangeBatch::ContentField;
+                    }
+                }
+                stored->finish();
+            }
+        }
+        
+        QSqlQuery *query = statements.statement(SqlUpdateNote);
+        if (!query) {
+            return false;
+        }
+        
+        query->bindValue(0, note.title());
+        query->bindValue(1, contentData);
+        query->bindValue(2, dictionaryId);
+        query->bindValue(3, projection.plainText);
+        query->bindValue(4, projection.firstLine);
+        query->bindValue(5, projection.snippet);
+        query->bindValue(6, projection.charCount);
+        query->bindValue(7, projection.wordCount);
+        query->bindValue(8, projection.searchTitle);
+        query->bindValue(9, projection.searchBody);
+        query->bindValue(10, note.updateTime());
+        query->bindValue(11, note.id());
         
-        if (!query.exec()) {
-            qDebug() << "更新笔记失败: " << query.lastError().text();
+        if (!query->exec()) {
+            qDebug() << "更新笔记失败: " << query->lastError().text();
             return false;
         }
+        
+        // 便签已被删除：不算保存成功，也不能再登记图片引用（没有删除便签的触发器会清理它们）
+        if (query->numRowsAffected() == 0) {
+            qDebug() << "更新笔记失败: 便签不存在" << note.id();
+            return false;
+        }
+        
+        if (changes) {
+            changes->noteUpdated(note.id(), fields);
+        }
     }
     
-    return true;
+    return writeImageRefs(statements, note.id(), NoteImageStore::referenceKeys(note.content()));
 }
 
-bool NoteDatabase::deleteNote(int id)
+bool NoteDatabase::writeImageRefs(NoteStatementCache &statements, int noteId, const QStringList &keys)
 {
-    if (!m_isOpen) {
-        if (!open()) {
+    QSqlQuery *remove = statements.statement(SqlDeleteImageRefs);
+    if (!remove) {
+        return false;
+    }
+    
+    remove->bindValue(0, noteId);
+    if (!remove->exec()) {
+        qDebug() << "更新图片引用失败: " << remove->lastError().text();
+        return false;
+    }
+    
+    for (const QString &key : keys) {
+        QSqlQuery *insert = statements.statement(SqlInsertImageRef);
+        if (!insert) {
+            return false;
+        }
+        
+        insert->bindValue(0, noteId);
+        insert->bindValue(1, key);
+        if (!insert->exec()) {
+            qDebug() << "更新图片引用失败: " << insert->lastError().text();
             return false;
         }
     }
     
-    QSqlQuery query;
-    query.prepare("DELETE FROM notes WHERE id = ?");
-    query.addBindValue(id);
+    return true;
+}
+
+bool NoteDatabase::writeNotes(QSqlDatabase &db, NoteStatementCache &statements,
+                              QList<Note> &notes, QList<bool> &results, NoteChangeBatch *changes)
+{
+    results.clear();
+    
+    // 整批在一个事务中写入；每一项使用保存点，失败时只撤销该项已执行的语句
+    bool inTransaction = db.transaction();
+    QSqlQuery savepoint(db);
     
-    if (!query.exec()) {
-        qDebug() << "删除笔记失败: " << query.lastError().text();
+    for (Note &note : notes) {
+        savepoint.exec("SAVEPOINT note_write");
+        
+        Note written = note;
+        NoteChangeBatch itemChanges;
+        bool ok = writeNote(statements, written, changes ? &itemChanges : nullptr);
+        if (ok) {
+            savepoint.exec("RELEASE note_write");
+            note = written;
+            if (changes) {
+                changes->merge(itemChanges);
+            }
+        } else {
+            savepoint.exec("ROLLBACK TO note_write");
+            savepoint.exec("RELEASE note_write");
+        }
+        
+        results.append(ok);
+    }
+    
+    if (inTransaction && !db.commit()) {
+        qDebug() << "批量保存提交失败: " << db.lastError().text();
+        db.rollback();
+        for (int i = 0; i < results.size(); ++i) {
+            results[i] = false;
+        }
+        if (changes) {
+            *changes = NoteChangeBatch();
+        }
         return false;
     }
     
     return true;
 }
 
-Note NoteDatabase::getNote(int id)
+QList<bool> NoteDatabase::saveNotes(QList<Note> &notes)
 {
-    Note note;
+    QList<bool> results;
     
     if (!m_isOpen) {
         if (!open()) {
-            return note;
+            for (int i = 0; i < notes.size(); ++i) {
+                results.append(false);
+            }
+            return results;
         }
     }
     
-    QSqlQuery query;
-    query.prepare("SELECT id, title, content, create_time, update_time FROM notes WHERE id = ?");
-    query.addBindValue(id);
+    // 先写完队列中的保存，避免较早的版本在批量写入之后覆盖它们
+    flushPendingWrites();
     
-    if (!query.exec()) {
-        qDebug() << "获取笔记失败: " << query.lastError().text();
-        return note;
+    NoteChangeBatch changes;
+    writeNotes(m_db, m_statements, notes, results, &changes);
+    
+    for (const Note &note : notes) {
+        m_noteCache.invalidate(note.id());
     }
     
-    if (query.next()) {
-        note.setId(query.value(0).toInt());
-        note.setTitle(query.value(1).toString());
-        note.setContent(query.value(2).toString());
-        note.setCreateTime(query.value(3).toDateTime());
-        note.setUpdateTime(query.value(4).toDateTime());
+    if (!changes.isEmpty()) {
+        emit notesChanged(changes);
     }
     
-    return note;
+    return results;
 }
 
-QList<Note> NoteDatabase::getAllNotes()
+QList<bool> NoteDatabase::deleteNotes(const QList<int> &ids)
 {
-    QList<Note> notes;
+    QList<bool> results;
     
     if (!m_isOpen) {
         if (!open()) {
-            return notes;
+            for (int i = 0; i < ids.size(); ++i) {
+                results.append(false);
+            }
+            return results;
         }
     }
     
-    QSqlQuery query("SELECT id, title, content, create_time, update_time FROM notes ORDER BY update_time DESC");
+    // 丢弃这些便签尚未写入的保存，并等待正在进行的写入完成
+    for (int id : ids) {
+        m_writer->discard(id);
+    }
+    flushPendingWrites();
+    
+    bool inTransaction = m_db.transaction();
     
-    if (!query.exec()) {
-        qDebug() << "获取所有笔记失败: " << query.lastError().text();
-        return notes;
+    for (int id : ids) {
+        QSqlQuery *query = m_statements.statement(SqlDeleteNote);
+        bool ok = query != nullptr;
+        if (ok) {
+            query->bindValue(0, id);
+            ok = query->exec();
+            if (!ok) {
+                qDebug() << "删除笔记失败: " << query->lastError().text();
+            }
+        }
+        results.append(ok);
     }
     
-    while (query.next()) {
-        Note note;
-        note.setId(query.value(0).toInt());
-        note.setTitle(query.value(1).toString());
-        note.setContent(query.value(2).toString());
-        note.setCreateTime(query.value(3).toDateTime());
-        note.setUpdateTime(query.value(4).toDateTime());
-        notes.append(note);
+    if (inTransaction && !m_db.commit()) {
+        qDebug() << "批量删除提交失败: " << m_db.lastError().text();
+        m_db.rollback();
+        for (int i = 0; i < results.size(); ++i) {
+            results[i] = false;
+        }
     }
     
-    return notes;
+    NoteChangeBatch changes;
+    for (int i = 0; i < ids.size(); ++i) {
+        m_noteCache.invalidate(ids.at(i));
+        if (results.at(i)) {
+            changes.noteDeleted(ids.at(i));
+        }
+    }
+    
+    if (!changes.isEmpty()) {
+        emit notesChanged(changes);
+    }
+    
+    return results;
 }
 
-QList<Note> NoteDatabase::searchNotes(const QString &keyword)
+bool NoteDatabase::deleteNote(int id)
 {
-    QList<Note> notes;
-    
     if (!m_isOpen) {
         if (!open()) {
-            return notes;
+            return false;
         }
     }
     
-    QSqlQuery query;
-    query.prepare("SELECT id, title, content, create_time, update_time FROM notes "
-                 "WHERE title LIKE ? OR content LIKE ? "
-                 "ORDER BY update_time DESC");
-    query.addBindValue(QString("%%1%").arg(keyword));
-    query.addBindValue(QString("%%1%").arg(keyword));
+    // 丢弃该便签尚未写入的保存，并等待正在进行的写入完成，避免删除后被重新写回
+    m_writer->discard(id);
+    flushPendingWrites();
+    
+    QSqlQuery *query = m_statements.statement(SqlDeleteNote);
+    if (!query) {
+        return false;
+    }
+    
+    query->bindValue(0, id);
     
-    if (!query.exec()) {
-        qDebug() << "搜索笔记失败: " << query.lastError().text();
-        return notes;
+    bool success = query->exec();
+    if (!success) {
+        qDebug() << "删除笔记失败: " << query->lastError().text();
     }
+    m_noteCache.invalidate(id);
     
-    while (query.next()) {
-        Note note;
-        note.setId(query.value(0).toInt());
-        note.setTitle(query.value(1).toString());
-        note.setContent(query.value(2).toString());
-        note.setCreateTime(query.value(3).toDateTime());
-        note.setUpdateTime(query.value(4).toDateTime());
-        notes.append(note);
+    if (success) {
+        NoteChangeBatch changes;
+        changes.noteDeleted(id);
+        emit notesChanged(changes);
     }
     
-    return notes;
+    return success;
+}
+
+Note NoteDatabase::getNote(int id)
+{
+    Note note;
+    
+    if (!ensureOpen()) {
+        return note;
+    }
+    
+    // 后台线程使用本线程的读连接；持有租约期间close()不会停止写线程
+    NoteConnectionPool::Lease reader(m_readers);
+    if (!reader.statements()) {
+        return note;
+    }
+    
+    // 写线程中尚未提交的保存比数据库和缓存中的版本新（合并窗口内关闭又打开便签窗口）
+    if (m_writer && m_writer->pendingNote(id, note)) {
+        return note;
+    }
+    
+    if (m_noteCache.lookup(id, note)) {
+        return note;
+    }
+    
+    // 先记下缓存版本，读取期间便签被保存时不缓存读到的旧内容
+    quint64 cacheGeneration = m_noteCache.generation();
+    
+    QSqlQuery *query = reader.statements()->statement(SqlSelectNote);
+    if (!query) {
+        return note;
+    }
+    
+    query->bindValue(0, id);
+    
+    if (!query->exec()) {
+        qDebug() << "获取笔记失败: " << query->lastError().text();
+        return note;
+    }
+    
+    if (query->next()) {
+        note = readNote(*query);
+        m_noteCache.insert(note, cacheGeneration);
+    }
+    query->finish();
+    
+    return note;
+}
+
+QList<NoteSummary> NoteDatabase::getNotesPage(const NotePageCursor &after, int limit)
+{
+    QList<NoteSummary> summaries;
+    
+    if (!ensureOpen()) {
+        return summaries;
+    }
+    
+    NoteConnectionPool::Lease reader(m_readers);
+    if (!reader.statements()) {
+        return summaries;
+    }
+    
+    QSqlQuery *query = reader.statements()->statement(after.isValid() ? SqlSelectNextPage : SqlSelectFirstPage);
+    if (!query) {
+        return summaries;
+    }
+    
+    if (after.isValid()) {
+        query->bindValue(0, after.updateTime);
+        query->bindValue(1, after.id);
+        query->bindValue(2, limit);
+    } else {
+        query->bindValue(0, limit);
+    }
+    
+    if (!query->exec()) {
+        qDebug() << "获取便签列表失败: " << query->lastError().text();
+        return summaries;
+    }
+    
+    while (query->next()) {
+        summaries.append(readSummary(*query));
+    }
+    query->finish();
+    
+    return summaries;
+}
+
+NoteSummary NoteDatabase::getNoteSummary(int id)
+{
+    NoteSummary summary;
+    
+    if (!ensureOpen()) {
+        return summary;
+    }
+    
+    NoteConnectionPool::Lease reader(m_readers);
+    if (!reader.statements()) {
+        return summary;
+    }
+    
+    QSqlQuery *query = reader.statements()->statement(SqlSelectSummary);
+    if (!query) {
+        return summary;
+    }
+    
+    query->bindValue(0, id);
+    
+    if (!query->exec()) {
+        qDebug() << "获取便签摘要失败: " << query->lastError().text();
+        return summary;
+    }
+    
+    if (query->next()) {
+        summary = readSummary(*query);
+    }
+    query->finish();
+    
+    return summary;
+}
+
+QList<NoteChange> NoteDatabase::changesSince(qint64 seq, int limit)
+{
+    QList<NoteChange> changes;
+    
+    if (!ensureOpen()) {
+        return changes;
+    }
+    
+    // 写线程中排队的保存也应计入
+    flushPendingWrites();
+    
+    NoteConnectionPool::Lease reader(m_readers);
+    if (!reader.statements()) {
+        return changes;
+    }
+    
+    QSqlQuery *query = reader.statements()->statement(SqlSelectChangesSince);
+    if (!query) {
+        return changes;
+    }
+    
+    query->bindValue(0, seq);
+    query->bindValue(1, limit);
+    
+    if (!query->exec()) {
+        qDebug() << "读取变更日志失败: " << query->lastError().text();
+        return changes;
+    }
+    
+    while (query->next()) {
+        NoteChange change;
+        change.seq = query->value(0).toLongLong();
+        change.noteId = query->value(1).toInt();
+        change.type = static_cast<NoteChange::Type>(query->value(2).toInt());
+        change.time = QDateTime::fromString(query->value(3).toString(), Qt::ISODateWithMs);
+        changes.append(change);
+    }
+    query->finish();
+    
+    return changes;
+}
+
+qint64 NoteDatabase::latestChangeSeq()
+{
+    if (!ensureOpen()) {
+        return 0;
+    }
+    
+    flushPendingWrites();
+    
+    NoteConnectionPool::Lease reader(m_readers);
+    if (!reader.statements()) {
+        return 0;
+    }
+    
+    QSqlQuery *query = reader.statements()->statement(SqlSelectLatestChangeSeq);
+    if (!query || !query->exec() || !query->next()) {
+        return 0;
+    }
+    
+    qint64 seq = query->value(0).toLongLong();
+    query->finish();
+    
+    return seq;
+}
+
+QList<NoteSummary> NoteDatabase::searchNotes(const QString &keyword)
+{
+    QList<NoteSummary> summaries;
+    searchNotes(keyword, [&summaries](const QList<NoteSummary> &batch) {
+        summaries.append(batch);
+        return true;
+    });
+    return summaries;
+}
+
+bool NoteDatabase::searchNotes(const QString &keyword, const SearchBatchHandler &handler)
+{
+    if (!ensureOpen()) {
+        return false;
+    }
+    
+    NoteConnectionPool::Lease reader(m_readers);
+    if (!reader.statements()) {
+        return false;
+    }
+    
+    // 先按词搜索（按相关度排序），再补充命中在词中间的便签（按更新时间排序）
+    QSet<int> found;
+    bool stopped = false;
+    bool substringDone = false;
+    
+    QString matchExpression = NoteText::toMatchExpression(keyword);
+    if (m_hasFts && !matchExpression.isEmpty() && isIndexReady(*reader.statements(), "notes_fts")) {
+        appendSearchResults(*reader.statements(), SqlSearchFts, {matchExpression}, keyword,
+                            found, handler, stopped);
+    }
+    
+    // 子串优先走三元组索引
+    QString substringExpression = NoteText::toSubstringMatchExpression(keyword);
+    if (!stopped && m_hasTrigram && !substringExpression.isEmpty() && found.size() < SearchResultLimit &&
+        isIndexReady(*reader.statements(), "notes_trigram")) {
+        substringDone = appendSearchResults(*reader.statements(), SqlSearchTrigram, {substringExpression}, keyword,
+                                            found, handler, stopped);
+    }
+    
+    // 有少于3个字符的词（三元组索引无法匹配）或索引不可用时逐行匹配纯文本，结果数量有上限
+    if (!stopped && !substringDone && found.size() < SearchResultLimit) {
+        QString pattern = QString("%%1%").arg(keyword);
+        if (!appendSearchResults(*reader.statements(), SqlSearchLike, {pattern, pattern}, keyword,
+                                 found, handler, stopped)) {
+            return false;
+        }
+    }
+    
+    return !stopped;
+}
+
+// 搜索索引是否已包含全部便签，补齐期间的搜索改为逐行匹配
+bool NoteDatabase::isIndexReady(NoteStatementCache &statements, const QString &name)
+{
+    QSqlQuery *query = statements.statement(SqlSelectIndexBackfill);
+    if (!query) {
+        return false;
+    }
+    
+    query->bindValue(0, name);
+    bool pending = query->exec() && query->next();
+    query->finish();
+    
+    return !pending;
+}
+
+// 执行一种搜索，跳过已找到的便签，结果分批交给handler
+// bindings依次绑定到语句的参数，最后一个参数为结果数量上限
+// 返回搜索是否执行成功（索引不可用时失败）；handler要求停止时stopped为true
+bool NoteDatabase::appendSearchResults(NoteStatementCache &statements, const QString &sql,
+                                       const QVariantList &bindings, const QString &keyword,
+                                       QSet<int> &found, const SearchBatchHandler &handler, bool &stopped)
+{
+    QSqlQuery *query = statements.statement(sql);
+    if (!query) {
+        return false;
+    }
+    
+    for (int i = 0; i < bindings.size(); ++i) {
+        query->bindValue(i, bindings.at(i));
+    }
+    query->bindValue(bindings.size(), SearchResultLimit);
+    
+    if (!query->exec()) {
+        qDebug() << "搜索笔记失败: " << query->lastError().text();
+        return false;
+    }
+    
+    QList<NoteSummary> batch;
+    while (query->next() && found.size() < SearchResultLimit) {
+        int id = query->value(0).toInt();
+        if (found.contains(id)) {
+            continue;
+        }
+        
+        found.insert(id);
+        batch.append(readSearchResult(*query, keyword));
+        if (batch.size() >= SearchBatchSize) {
+            if (!handler(batch)) {
+                stopped = true;
+                break;
+            }
+            batch.clear();
+        }
+    }
+    query->finish();
+    
+    if (!stopped && !batch.isEmpty()) {
+        stopped = !handler(batch);
+    }
+    
+    return true;
+}
+
+// 读取搜索结果，列顺序同摘要，最后一列为纯文本，用于截取命中摘要
+NoteSummary NoteDatabase::readSearchResult(const QSqlQuery &query, const QString &keyword)
+{
+    NoteSummary summary = readSummary(query);
+    summary.snippet = NoteText::highlightSnippet(query.value(8).toString(), keyword, NoteText::SnippetLength,
+                                                 NoteSummary::HighlightBegin, NoteSummary::HighlightEnd);
+    return summary;
+}
+
+// 从结果行读取摘要
+// 列顺序为 id, title, create_time, update_time, first_line, snippet, char_count, word_count
+NoteSummary NoteDatabase::readSummary(const QSqlQuery &query)
+{
+    NoteSummary summary;
+    summary.id = query.value(0).toInt();
+    summary.title = query.value(1).toString();
+    summary.createTime = query.value(2).toDateTime();
+    summary.updateTime = query.value(3).toDateTime();
+    summary.snippet = query.value(5).toString();
+    summary.charCount = query.value(6).toInt();
+    summary.wordCount = query.value(7).toInt();
+    
+    // 无标题便签使用内容的第一行作为标题
+    if (summary.title.isEmpty()) {
+        summary.title = query.value(4).toString();
+    }
+    
+    return summary;
+}
+
+// 从结果行读取便签，列顺序为 id, title, content, create_time, update_time, 文档头字典
+// 内容只在读取完整便签时解压，列表和搜索不会读取内容列
+Note NoteDatabase::readNote(const QSqlQuery &query)
+{
+    Note note;
+    note.setId(query.value(0).toInt());
+    note.setTitle(query.value(1).toString());
+    note.setContent(decodeContent(query.value(2), query.value(5).toString()));
+    note.setCreateTime(query.value(3).toDateTime());
+    note.setUpdateTime(query.value(4).toDateTime());
+    return note;
 } 
\ No newline at end of file
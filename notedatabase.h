@@ -4,37 +4,177 @@
 #include <QObject>
 #include <QSqlDatabase>
 #include <QList>
+#include <QSet>
+#include <functional>
+#include <atomic>
 #include "note.h"
+#include "notestatementcache.h"
+#include "notecache.h"
+#include "notemaintenance.h"
 
+class NoteWriter;
+class NoteImageCollector;
+class NoteConnectionPool;
+class QThread;
+
+// 便签存储服务
+// 整个进程只存在一个实例，由main()创建并持有，所有窗口通过instance()共享。
+// 实例独占一个命名数据库连接，不再使用Qt的默认连接。
+// 读取方法（getNote、getNoteSummary、getNotesPage、searchNotes、changesSince、latestChangeSeq）
+// 可以在任意线程调用，后台线程使用连接池中本线程的读连接；
+// 写入方法、快照和open()/close()只能在本对象所在线程调用。
 class NoteDatabase : public QObject
 {
     Q_OBJECT
 public:
     explicit NoteDatabase(QObject *parent = nullptr);
     ~NoteDatabase();
-
+    
+    // 获取进程内共享的存储服务实例
+    static NoteDatabase *instance();
+    
     bool open();
     void close();
     bool isOpen() const;
-
+    
     // 笔记相关操作
     bool saveNote(Note &note);
+    
+    // 异步保存：请求交给写线程批量写入，完成后发出noteSaveFinished
+    // 新便签拿到ID之前的后续保存传入之前的请求编号，与其插入合并（见NoteWriter::enqueue）
+    // 返回请求编号，数据库无法打开时返回0
+    quint64 saveNoteAsync(const Note &note, quint64 insertRequestId = 0);
+    // 阻塞等待所有排队的保存写入磁盘，返回前完成通知已派发（其他线程调用时不等待）
+    void flushPendingWrites();
+    
     bool deleteNote(int id);
+    
+    // 批量保存/删除：整批在一个事务中完成，只需一次磁盘同步
+    // 返回每一项的结果，与输入顺序一致；单项失败只撤销该项，不影响其他项
+    // saveNotes()会为新便签填入数据库分配的ID
+    QList<bool> saveNotes(QList<Note> &notes);
+    QList<bool> deleteNotes(const QList<int> &ids);
+    
+    // 读取完整便签，最近读取过的便签直接从缓存返回
     Note getNote(int id);
-    QList<Note> getAllNotes();
-    QList<Note> searchNotes(const QString &keyword);
+    
+    // 分页读取便签摘要（不读取完整内容），按更新时间倒序
+    // after为上一页最后一条的游标，默认游标读取第一页
+    QList<NoteSummary> getNotesPage(const NotePageCursor &after, int limit);
+    // 读取单个便签的摘要（列表局部更新时使用），便签不存在时id为-1
+    NoteSummary getNoteSummary(int id);
+    QList<NoteSummary> searchNotes(const QString &keyword);
+    
+    // 分批返回搜索结果：按词命中的结果按相关度在前，子串命中的结果随后，每批按顺序交给handler
+    // handler返回false时停止搜索（例如已被更新的搜索取代），此时返回false；搜索失败也返回false
+    using SearchBatchHandler = std::function<bool(const QList<NoteSummary> &batch)>;
+    bool searchNotes(const QString &keyword, const SearchBatchHandler &handler);
+    
+    // 变更日志：返回序号大于seq的变更（按序号升序，最多limit条）
+    // 同步、索引维护、备份等记录已处理到的序号，下次只需处理之后的变更
+    QList<NoteChange> changesSince(qint64 seq, int limit = 1000);
+    // 当前最大的变更序号，没有任何变更时为0
+    qint64 latestChangeSeq();
     
     // 获取数据库目录和路径的静态方法
     static QString getDatabaseDir();
     static QString getDatabasePath();
+    
+    // 主连接名称
+    static const char *const MainConnectionName;
+    
+    // 在指定连接上写入便签（同步保存与写线程共用），语句来自该连接的缓存
+    // changes不为空时记录这次写入的变更
+    static bool writeNote(NoteStatementCache &statements, Note &note, NoteChangeBatch *changes = nullptr);
+    
+    // 在指定连接上批量写入便签（批量保存与写线程共用），results返回每一项的结果
+    // changes只记录已提交的项，整批提交失败时为空
+    static bool writeNotes(QSqlDatabase &db, NoteStatementCache &statements,
+                           QList<Note> &notes, QList<bool> &results, NoteChangeBatch *changes = nullptr);
+    
+    // 按便签内容重新登记其引用的图片（键见NoteImageStore::referenceKey）
+    static bool writeImageRefs(NoteStatementCache &statements, int noteId, const QStringList &keys);
+    
+    // 编码/解码内容列（见内容压缩），preamble为关联的文档头字典
+    // 编码时按需登记字典，dictionaryId为空表示内容以原文保存
+    static bool encodeContent(NoteStatementCache &statements, const QString &content,
+                              QVariant &data, QVariant &dictionaryId);
+    static QString decodeContent(const QVariant &data, const QString &preamble);
+    
+    // 短于此长度的内容不压缩
+    static const int CompressionThreshold = 256;
+    
+    // 为连接应用存储配置（每个连接打开后都需要调用）
+    static bool applyStorageProfile(QSqlDatabase &db);
+    
+    // 将WAL中的内容合并回主数据库文件
+    bool checkpoint(bool truncate = false);
+    
+    // 在线快照：在后台线程中把数据库的一致副本写入snapshotPath（已存在的文件会被覆盖），完成后发出snapshotFinished
+    // 快照期间数据库保持打开，编辑和保存不受影响；快照是不带WAL的单个文件，可直接导出、上传
+    // 只能在本对象所在线程调用：排队的保存先在本线程写入，快照包含调用之前的全部编辑
+    // 快照无法开始时返回false，之后不会再发出snapshotFinished
+    bool startSnapshot(const QString &snapshotPath);
+    
+    // 压缩数据库：写出没有空闲页、使用增量回收模式的副本并替换原文件，完成后发出compactionFinished
+    // 用于空闲维护无法直接切换回收模式的较大数据库（维护报告的compactionNeeded）
+    // 复制在后台线程中进行，期间数据库保持打开；复制期间有便签被修改时放弃替换，可稍后重试
+    // 只能在本对象所在线程调用，无法开始时返回false
+    bool startCompaction();
+
+signals:
+    // 异步保存完成，note中带有数据库分配的ID
+    void noteSaveFinished(quint64 requestId, const Note &note, bool success);
+    
+    // 一批便签变更已提交（同步保存、删除，或写线程的一个事务）
+    // 写线程的变更以排队方式到达，接收者总在本对象所在线程中收到
+    void notesChanged(const NoteChangeBatch &changes);
+    
+    // 写线程空闲时完成了一轮数据库维护（回收空闲页、更新统计信息、完整性检查）
+    void maintenanceFinished(const NoteMaintenanceReport &report);
+    
+    // startSnapshot()的快照已完成（在本对象所在线程中发出）
+    void snapshotFinished(const QString &snapshotPath, bool success);
+    
+    // startCompaction()已完成，reclaimedBytes为数据库文件缩小的字节数
+    void compactionFinished(bool success, qint64 reclaimedBytes);
 
 private:
+    bool ensureOpen();
     bool createTables();
     bool initDatabase();
+    void startWriter();
+    static Note readNote(const QSqlQuery &query);
+    static NoteSummary readSummary(const QSqlQuery &query);
+    static NoteSummary readSearchResult(const QSqlQuery &query, const QString &keyword);
+    static bool isIndexReady(NoteStatementCache &statements, const QString &name);
+    static bool appendSearchResults(NoteStatementCache &statements, const QString &sql,
+                                    const QVariantList &bindings, const QString &keyword,
+                                    QSet<int> &found, const SearchBatchHandler &handler, bool &stopped);
+    void stopWriter();
+    void startImageCollector();
+    void stopImageCollector();
+    void waitForSnapshots();
+    bool runSnapshot(const QString &snapshotPath, bool incrementalVacuum, const std::function<void(bool)> &finished);
+    bool replaceWithCompacted(const QString &compactPath, qint64 seq, qint64 &reclaimedBytes);
+    static bool writeSnapshot(const QString &dbPath, const QString &snapshotPath, bool incrementalVacuum);
+    
+    static NoteDatabase *s_instance;
     
+    NoteWriter *m_writer;
+    QThread *m_writerThread;
+    NoteImageCollector *m_imageCollector;
+    QThread *m_imageCollectorThread;
+    NoteConnectionPool *m_readers;
+    QList<QThread *> m_snapshotThreads;  // 正在进行的快照
     QSqlDatabase m_db;
+    NoteStatementCache m_statements;
+    NoteCache m_noteCache;  // 最近读取的便签，保存、删除后失效
     QString m_dbPath;
-    bool m_isOpen;
+    // 后台线程的读取也会检查这些标志，由open()/close()在本对象所在线程中修改
+    std::atomic<bool> m_isOpen;
+    std::atomic<bool> m_hasFts;      // 全文索引是否可用
+    std::atomic<bool> m_hasTrigram;  // 子串索引是否可用
 };
 
 #endif // NOTEDATABASE_H 
\ No newline at end of file
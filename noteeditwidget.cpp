@@ -1,5 +1,7 @@
 #include "noteeditwidget.h"
 #include "ui_noteeditwidget.h"
+#include "notetext.h"
+#include "noteimagestore.h"
 #include <QDateTime>
 #include <QMessageBox>
 #include <QTextCharFormat>
@@ -21,7 +23,6 @@
 #include <QTimer>
 #include <QTextCursor>
 #include <QDir>
-#include <QUuid>
 #include <QFile>
 #include <QFileInfo>
 #include <QApplication>
@@ -36,8 +37,10 @@
 NoteEditWidget::NoteEditWidget(QWidget *parent) :
     QWidget(parent),
     ui(new Ui::NoteEditWidget),
-    m_database(new NoteDatabase(this)),
+    m_database(NoteDatabase::instance()),
     m_autoSaveTimer(new QTimer(this)),
+    m_wordCountTimer(new QTimer(this)),
+    m_currentSaveRequest(0),
     m_isNewNote(false),
     m_hasChanges(false),
     m_isLoadingNote(false),
@@ -56,6 +59,10 @@ NoteEditWidget::NoteEditWidget(QWidget *parent) :
     // 设置自动保存定时器
     m_autoSaveTimer->setInterval(3000); // 3秒钟自动保存
     
+    // 设置字数统计延迟
+    m_wordCountTimer->setSingleShot(true);
+    m_wordCountTimer->setInterval(300);
+    
     // 确保图片目录存在
     ensureImageDirectoryExists();
     
@@ -63,22 +70,22 @@ NoteEditWidget::NoteEditWidget(QWidget *parent) :
     setupConnections();
     setupImageInteractions();
     
-    // 打开数据库
-    if (!m_database->open()) {
-        QMessageBox::warning(this, "错误", "无法打开数据库");
-    }
+    // 使用共享的存储服务，打开窗口时不再需要初始化数据库
+    connect(m_database, &NoteDatabase::noteSaveFinished, this, &NoteEditWidget::onNoteSaveFinished);
 }
 
 NoteEditWidget::~NoteEditWidget()
 {
+    // 窗口销毁后不再接收保存结果
+    disconnect(m_database, nullptr, this, nullptr);
+    
     // 如果有未保存的更改，保存它们
+    // 排队的保存由写线程继续完成（关闭数据库时会写完），图片引用随之登记；
+    // 未被任何便签引用的图片由后台的NoteImageCollector回收，窗口不直接删除图片文件
     if (m_hasChanges) {
         saveChanges();
     }
     
-    // 清理临时图片
-    cleanupUnusedImages();
-    
     // 清理缓存的原始图片
     m_originalImages.clear();
     
@@ -225,7 +232,8 @@ void NoteEditWidget::setupUI()
 void NoteEditWidget::setupConnections()
 {
     connect(ui->contentTextEdit, &QTextEdit::textChanged, this, &NoteEditWidget::onContentChanged);
-    connect(ui->contentTextEdit, &QTextEdit::textChanged, this, &NoteEditWidget::updateWordCount);
+    connect(ui->contentTextEdit, &QTextEdit::textChanged, m_wordCountTimer, qOverload<>(&QTimer::start));
+    connect(m_wordCountTimer, &QTimer::timeout, this, &NoteEditWidget::updateWordCount);
     connect(ui->titleLineEdit, &QLineEdit::textChanged, this, &NoteEditWidget::onTitleChanged);
     connect(ui->boldButton, &QPushButton::clicked, this, &NoteEditWidget::onBoldButtonClicked);
     connect(ui->italicButton, &QPushButton::clicked, this, &NoteEditWidget::onItalicButtonClicked);
@@ -261,11 +269,7 @@ void NoteEditWidget::setupConnections()
                 image = resizeImageToFitWidth(image);
                 
                 // 保存图片到文件
-                QString filePath = saveImageToFile(originalImage, "file");
-                
-                // 生成资源名称
-                static int fileImageCounter = 0;
-                QString imageName = QString("file_image_%1").arg(++fileImageCounter);
+                QString filePath = saveImageToFile(originalImage);
                 
                 // 将图片添加到文档资源
                 ui->contentTextEdit->document()->addResource(
@@ -286,9 +290,6 @@ void NoteEditWidget::setupConnections()
                 // 插入图片到光标位置
                 ui->contentTextEdit->textCursor().insertImage(imageFormat);
                 
-                // 记录临时图片映射
-                m_tempImages[imageName] = filePath;
-                
                 // 标记文档已修改
                 m_hasChanges = true;
                 m_autoSaveTimer->start();
@@ -309,6 +310,10 @@ void NoteEditWidget::setNote(const Note &note)
         saveChanges();
     }
     
+    // 之前便签的保存结果不再影响当前便签
+    m_currentSaveRequest = 0;
+    m_insertRequests.clear();
+    
     m_currentNote = note;
     m_isNewNote = false;
     
@@ -393,6 +398,10 @@ void NoteEditWidget::createNewNote()
         saveChanges();
     }
     
+    // 之前便签的保存结果不再影响当前便签
+    m_currentSaveRequest = 0;
+    m_insertRequests.clear();
+    
     // 创建新的笔记对象
     m_currentNote = Note();
     m_isNewNote = true;
@@ -465,41 +474,57 @@ void NoteEditWidget::saveChanges()
     // 更新窗口标题
     setWindowTitle(title.isEmpty() ? "便签" : title);
     
-    // 保存到数据库
-    if (m_database->saveNote(m_currentNote)) {
-        m_hasChanges = false;
+    // 交给写线程异步保存，结果在onNoteSaveFinished中处理
+    // 新便签的插入还未完成时，写线程把这次保存与之合并，不会重复插入
+    bool isInsert = (m_currentNote.id() == -1);
+    quint64 requestId = m_database->saveNoteAsync(m_currentNote, isInsert ? m_currentSaveRequest : 0);
+    if (requestId == 0) {
+        return;
+    }
+    
+    m_currentSaveRequest = requestId;
+    m_pendingSaveRequests.insert(requestId);
+    if (isInsert) {
+        m_insertRequests.insert(requestId);
+    }
+    m_hasChanges = false;
+}
+
+void NoteEditWidget::onNoteSaveFinished(quint64 requestId, const Note &note, bool success)
+{
+    // 只处理本窗口发出的请求
+    if (!m_pendingSaveRequests.remove(requestId)) {
+        return;
+    }
+    
+    bool isCurrent = (requestId == m_currentSaveRequest);
+    if (isCurrent) {
+        m_currentSaveRequest = 0;
+    }
+    
+    // 新便签的插入已完成，之后的保存按ID更新
+    bool isInsert = m_insertRequests.remove(requestId);
+    if (success && isInsert && m_currentNote.id() == -1) {
+        m_currentNote.setId(note.id());
         m_isNewNote = false;
-        
-        // 获取便签ID
-        int noteId = m_currentNote.id();
-        
-        // 如果有临时图片，将其移动到便签特定目录
-        if (!m_tempImages.isEmpty() && noteId > 0) {
-            QString noteDirPath = getImageDirectory(noteId);
-            QDir dir;
-            if (!dir.exists(noteDirPath)) {
-                dir.mkpath(noteDirPath);
-            }
-            
-            // 移动临时图片到便签目录
-            for (auto it = m_tempImages.begin(); it != m_tempImages.end(); ++it) {
-                QString sourcePath = it.value();
-                QString fileName = QFileInfo(sourcePath).fileName();
-                QString targetPath = QString("%1/%2").arg(noteDirPath, fileName);
-                
-                // 如果源和目标不同，且目标不存在，则移动文件
-                if (sourcePath != targetPath && !QFile::exists(targetPath)) {
-                    QFile::copy(sourcePath, targetPath);
-                }
-            }
-            
-            // 清空临时图片映射
-            m_tempImages.clear();
+        m_insertRequests.clear();
+    }
+    
+    if (!success) {
+        // 保存失败，保留修改，等待下次自动保存重试
+        if (isCurrent) {
+            m_hasChanges = true;
+            m_autoSaveTimer->start();
         }
-        
-        // 发送保存成功信号
-        emit noteSaved(m_currentNote);
+        return;
+    }
+    
+    if (isCurrent) {
+        m_currentNote.setUpdateTime(note.updateTime());
     }
+    
+    // 发送保存成功信号
+    emit noteSaved(note);
 }
 
 void NoteEditWidget::closeEvent(QCloseEvent *event)
@@ -911,27 +936,11 @@ QImage NoteEditWidget::resizeImageToFitWidth(const QImage &image)
 }
 
 // 将图片保存到文件
-QString NoteEditWidget::saveImageToFile(const QImage &image, const QString &prefix)
+QString NoteEditWidget::saveImageToFile(const QImage &image)
 {
-    // 确保图片目录存在
-    ensureImageDirectoryExists();
-    
-    // 获取便签ID
-    int noteId = m_currentNote.id();
-    
-    // 获取存储目录
-    QString dirPath = getImageDirectory(noteId);
-    QDir dir;
-    if (!dir.exists(dirPath)) {
-        dir.mkpath(dirPath);
-    }
-    
-    // 生成唯一文件名
-    QString fileName = QString("%1_%2.png").arg(prefix).arg(QUuid::createUuid().toString(QUuid::WithoutBraces));
-    QString filePath = QString("%1/%2").arg(dirPath, fileName);
-    
-    // 保存图片
-    image.save(filePath, "PNG");
+    // 图片按内容保存在共享的图片存储中，相同的图片只保存一次，
+    // 不再区分便签目录，新便签也无需在保存后复制临时图片
+    QString filePath = NoteImageStore::store(image);
     
     // 保存原始图片到内存中，以便后续显示原图
     m_originalImages[filePath] = image;
@@ -963,11 +972,7 @@ bool NoteEditWidget::insertImageFromClipboard()
             image = resizeImageToFitWidth(image);
             
             // 保存图片到文件
-            QString filePath = saveImageToFile(originalImage, "clipboard");
-            
-            // 生成资源名称
-            static int imageCounter = 0;
-            QString imageName = QString("clipboard_image_%1").arg(++imageCounter);
+            QString filePath = saveImageToFile(originalImage);
             
             // 将调整后的图片添加到文档资源
             ui->contentTextEdit->document()->addResource(
@@ -988,9 +993,6 @@ bool NoteEditWidget::insertImageFromClipboard()
             // 插入图片到光标位置
             ui->contentTextEdit->textCursor().insertImage(imageFormat);
             
-            // 记录临时图片映射
-            m_tempImages[imageName] = filePath;
-            
             // 标记文档已修改
             m_hasChanges = true;
             m_autoSaveTimer->start();
@@ -1226,9 +1228,6 @@ void NoteEditWidget::processContentForSaving()
                         
                         // 应用新格式
                         tempCursor.setCharFormat(imageFormat);
-                        
-                        // 更新映射表
-                        m_tempImages[imageName] = filePath;
                     }
                 }
             }
@@ -1341,36 +1340,6 @@ void NoteEditWidget::processContentAfterLoading()
     }
 }
 
-// 清理未使用的图片
-void NoteEditWidget::cleanupUnusedImages()
-{
-    // 如果是临时便签（未保存），清理其所有临时图片
-    if (m_isNewNote && m_currentNote.id() <= 0) {
-        for (const QString &filePath : m_tempImages.values()) {
-            QFile::remove(filePath);
-        }
-    }
-    
-    // 清空临时图片映射
-    m_tempImages.clear();
-    
-    // 清理临时目录下的所有图片
-    // 注意：这部分代码谨慎使用，只在确保不会删除重要数据时启用
-    /*
-    QString tempDirPath = getImageDirectory(-1); // 获取临时目录
-    QDir tempDir(tempDirPath);
-    if (tempDir.exists()) {
-        QStringList filters;
-        filters << "*.png" << "*.jpg" << "*.jpeg" << "*.gif" << "*.bmp";
-        tempDir.setNameFilters(filters);
-        
-        for (const QString &file : tempDir.entryList(QDir::Files)) {
-            tempDir.remove(file);
-        }
-    }
-    */
-}
-
 // 设置图片交互
 void NoteEditWidget::setupImageInteractions()
 {
@@ -1740,29 +1709,8 @@ bool ImageEventFilter::eventFilter(QObject *watched, QEvent *event)
 void NoteEditWidget::updateWordCount()
 {
     if (!m_wordCountLabel) return;
-    // 获取正文纯文本内容
-    QString text = ui->contentTextEdit->toPlainText();
-    int count = 0;
-    // 统计汉字数量
-    QRegularExpression hanziRe("[\u4e00-\u9fa5]");
-    QRegularExpressionMatchIterator it = hanziRe.globalMatch(text);
-    while (it.hasNext()) {
-        it.next();
-        ++count;
-    }
-    // 统计英文单词数量
-    QRegularExpression wordRe("[A-Za-z]+(?:'[A-Za-z]+)?");
-    it = wordRe.globalMatch(text);
-    while (it.hasNext()) {
-        it.next();
-        ++count;
-    }
-    // 统计数字串数量（每个连续数字串算一个字）
-    QRegularExpression numRe("\\d+");
-    it = numRe.globalMatch(text);
-    while (it.hasNext()) {
-        it.next();
-        ++count;
-    }
+    m_wordCountTimer->stop();
+    // 统计规则与保存时写入数据库的字数相同
+    int count = NoteText::countWords(ui->contentTextEdit->toPlainText());
     m_wordCountLabel->setText(QString("字数：%1").arg(count));
 } 
\ No newline at end of file
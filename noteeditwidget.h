@@ -16,6 +16,7 @@
 #include <QDir>
 #include <QUuid>
 #include <QMap>
+#include <QSet>
 #include <QDialog>
 #include <QScrollArea>
 #include <QVBoxLayout>
@@ -117,19 +118,23 @@ private slots:
     void onPaste();
     void showImageViewer(const QImage &image); // 显示图片查看器
     void updateWordCount(); // 新增：更新字数统计
+    void onNoteSaveFinished(quint64 requestId, const Note &note, bool success); // 异步保存完成
 
 private:
     Ui::NoteEditWidget *ui;
     Note m_currentNote;
     NoteDatabase *m_database;
     QTimer *m_autoSaveTimer;
+    QTimer *m_wordCountTimer; // 字数统计延迟，连续输入时只在停顿后统计一次
+    quint64 m_currentSaveRequest; // 当前便签最近一次异步保存的请求编号
+    QSet<quint64> m_pendingSaveRequests; // 本窗口尚未完成的保存请求
+    QSet<quint64> m_insertRequests; // 当前新便签尚未完成的保存请求，任意一个完成即得到ID
     bool m_isNewNote;
     bool m_hasChanges;
     bool m_isLoadingNote;
     bool m_isStayOnTop;    // 窗口是否置顶
     QPushButton* m_stayOnTopButton; // 置顶按钮
     QDir m_imagesDir;      // 图片存储目录
-    QMap<QString, QString> m_tempImages; // 临时图片映射（资源名->文件路径）
     QMap<QString, QImage> m_originalImages; // 保存原始图片，用于显示原图
     ImageEventFilter *m_imageEventFilter; // 图片事件过滤器
     // 新增：字数统计标签指针
@@ -149,11 +154,10 @@ private:
     
     // 图片持久化相关方法
     void ensureImageDirectoryExists(); // 确保图片目录存在
-    QString saveImageToFile(const QImage &image, const QString &prefix = "img"); // 将图片保存到文件
+    QString saveImageToFile(const QImage &image); // 将图片保存到图片存储
     void processContentForSaving(); // 处理内容中的图片引用，准备保存
     void processContentAfterLoading(); // 加载后处理内容中的图片引用
     QString getImageDirectory(int noteId) const; // 获取特定便签的图片目录
-    void cleanupUnusedImages(); // 清理未使用的图片
 };
 
 #endif // NOTEEDITWIDGET_H 
\ No newline at end of file
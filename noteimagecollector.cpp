@@ -0,0 +1,329 @@
+#include "noteimagecollector.h"
+#include "notedatabase.h"
+#include "noteimagestore.h"
+#include "noteconnectionpool.h"
+#include "notewriter.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFile>
+#include <QDateTime>
+#include <QMutex>
+#include <QTextStream>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+namespace {
+const QString SqlSelectNoteContents = QStringLiteral(
+    "SELECT n.id, n.content, d.preamble FROM notes n "
+    "LEFT JOIN content_dictionaries d ON d.id = n.content_dict "
+    "WHERE n.id > ? ORDER BY n.id LIMIT ?");
+// 引用数，是否有释放时间，释放是否已超过宽限期（第一个参数为宽限期，如"-3600 seconds"）
+const QString SqlSelectBlobRelease = QStringLiteral(
+    "SELECT ref_count, release_time IS NOT NULL, "
+    "release_time <= strftime('%Y-%m-%dT%H:%M:%fZ', 'now', ?) "
+    "FROM image_blobs WHERE hash = ?");
+
+// 回收记录由回收线程追加、同步管理器读取和移除
+QMutex s_collectedMutex;
+}
+
+NoteImageCollector::NoteImageCollector(NoteConnectionPool *readers, NoteWriter *writer, QObject *parent)
+    : QObject(parent)
+    , m_readers(readers)
+    , m_writer(writer)
+    , m_sliceTimer(new QTimer(this))
+    , m_cycleTimer(new QTimer(this))
+    , m_phase(Idle)
+    , m_markCursor(0)
+    , m_removedFiles(0)
+    , m_removedBytes(0)
+{
+    m_sliceTimer->setInterval(SliceIntervalMs);
+    connect(m_sliceTimer, &QTimer::timeout, this, &NoteImageCollector::runSlice);
+    
+    m_cycleTimer->setSingleShot(true);
+    connect(m_cycleTimer, &QTimer::timeout, this, &NoteImageCollector::collect);
+}
+
+void NoteImageCollector::start()
+{
+    m_cycleTimer->start(InitialDelayMs);
+}
+
+void NoteImageCollector::stop()
+{
+    m_sliceTimer->stop();
+    m_cycleTimer->stop();
+    m_phase = Idle;
+    m_marked.clear();
+    m_sweepQueue.clear();
+    m_collected.clear();
+}
+
+void NoteImageCollector::collect()
+{
+    if (m_phase != Idle) {
+        return;
+    }
+    
+    m_phase = Marking;
+    m_markCursor = 0;
+    m_marked.clear();
+    m_sweepQueue.clear();
+    m_collected.clear();
+    m_removedFiles = 0;
+    m_removedBytes = 0;
+    
+    m_sliceTimer->start();
+}
+
+void NoteImageCollector::runSlice()
+{
+    switch (m_phase) {
+    case Marking:
+        markSlice();
+        break;
+    case Sweeping:
+        sweepSlice();
+        break;
+    case Idle:
+        m_sliceTimer->stop();
+        break;
+    }
+}
+
+void NoteImageCollector::markSlice()
+{
+    // 每批单独持有读连接，批次之间不占用WAL读快照
+    NoteConnectionPool::Lease reader(m_readers);
+    QSqlQuery *query = reader.statements() ? reader.statements()->statement(SqlSelectNoteContents) : nullptr;
+    if (!query) {
+        finishCycle();
+        return;
+    }
+    
+    query->bindValue(0, m_markCursor);
+    query->bindValue(1, MarkBatchSize);
+    
+    if (!query->exec()) {
+        qDebug() << "图片回收读取便签失败: " << query->lastError().text();
+        finishCycle();
+        return;
+    }
+    
+    int count = 0;
+    while (query->next()) {
+        m_markCursor = query->value(0).toInt();
+        QString content = NoteDatabase::decodeContent(query->value(1), query->value(2).toString());
+        for (const QString &image : NoteImageStore::referencedImages(content)) {
+            m_marked.insert(image);
+        }
+        ++count;
+    }
+    query->finish();
+    
+    if (count == MarkBatchSize) {
+        return;
+    }
+    
+    // 标记完成，列出所有图片文件准备清除
+    QString imagesDir = NoteImageStore::imagesDirectory();
+    QDir root(imagesDir);
+    QDirIterator it(imagesDir, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        m_sweepQueue.append(root.relativeFilePath(it.next()));
+    }
+    
+    m_phase = Sweeping;
+}
+
+void NoteImageCollector::sweepSlice()
+{
+    NoteConnectionPool::Lease reader(m_readers);
+    if (!reader.statements()) {
+        finishCycle();
+        return;
+    }
+    
+    QDateTime graceLimit = QDateTime::currentDateTime().addSecs(-GracePeriodSecs);
+    QString imagesDir = NoteImageStore::imagesDirectory();
+    QStringList released;
+    QStringList removed;
+    
+    for (int i = 0; i < SweepBatchSize && !m_sweepQueue.isEmpty(); ++i) {
+        QString relativePath = m_sweepQueue.takeLast();
+        if (m_marked.contains(relativePath)) {
+            continue;
+        }
+        
+        // 刚写入或刚被重新使用（见NoteImageStore::store）的文件
+        QString filePath = imagesDir + "/" + relativePath;
+        QFileInfo info(filePath);
+        if (!info.exists() || info.lastModified() > graceLimit) {
+            continue;
+        }
+        
+        // 以数据库中当前的引用数和释放时间为准
+        QString key = NoteImageStore::referenceKey(relativePath);
+        ReleaseState state = releaseState(*reader.statements(), key);
+        if (state == Unreleased) {
+            released.append(key);
+        }
+        if (state != Released) {
+            continue;
+        }
+        
+        qint64 size = info.size();
+        if (!QFile::remove(filePath)) {
+            continue;
+        }
+        
+        ++m_removedFiles;
+        m_removedBytes += size;
+        m_collected.append(relativePath);
+        removed.append(key);
+    }
+    
+    // 读连接是只读的，记录交给写线程写入
+    if (!released.isEmpty() || !removed.isEmpty()) {
+        NoteWriter *writer = m_writer;
+        QMetaObject::invokeMethod(writer, [writer, released, removed]() {
+            writer->recordImageSweep(released, removed);
+        }, Qt::QueuedConnection);
+    }
+    
+    if (m_sweepQueue.isEmpty()) {
+        finishCycle();
+    }
+}
+
+NoteImageCollector::ReleaseState NoteImageCollector::releaseState(NoteStatementCache &statements, const QString &key)
+{
+    QSqlQuery *query = statements.statement(SqlSelectBlobRelease);
+    if (!query) {
+        // 无法确认时按仍被引用处理
+        return Referenced;
+    }
+    
+    query->bindValue(0, QString("-%1 seconds").arg(GracePeriodSecs));
+    query->bindValue(1, key);
+    if (!query->exec()) {
+        return Referenced;
+    }
+    
+    ReleaseState state = Unreleased;
+    if (query->next()) {
+        if (query->value(0).toInt() > 0) {
+            state = Referenced;
+        } else if (query->value(1).toBool()) {
+            state = query->value(2).toBool() ? Released : InGracePeriod;
+        }
+    }
+    query->finish();
+    
+    return state;
+}
+
+void NoteImageCollector::finishCycle()
+{
+    if (m_phase == Sweeping) {
+        // 删除已经清空的便签图片目录（图片存储目录保留）
+        QDir root(NoteImageStore::imagesDirectory());
+        for (const QString &dirName : root.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            if (dirName != "blobs" && QDir(root.filePath(dirName)).isEmpty()) {
+                root.rmdir(dirName);
+            }
+        }
+        
+        if (m_removedFiles > 0) {
+            qDebug() << "图片回收完成，删除" << m_removedFiles << "个文件，共" << m_removedBytes << "字节";
+        }
+        
+        if (!m_collected.isEmpty()) {
+            QMutexLocker locker(&s_collectedMutex);
+            QStringList paths = readCollectedImages();
+            for (const QString &path : m_collected) {
+                if (!paths.contains(path)) {
+                    paths.append(path);
+                }
+            }
+            writeCollectedImages(paths);
+        }
+    }
+    
+    m_sliceTimer->stop();
+    m_phase = Idle;
+    m_marked.clear();
+    m_sweepQueue.clear();
+    m_collected.clear();
+    
+    m_cycleTimer->start(CycleIntervalMs);
+}
+
+QString NoteImageCollector::collectedListPath()
+{
+    // 放在images目录之外，避免被当作图片回收或同步
+    return NoteDatabase::getDatabaseDir() + "/collected_images.txt";
+}
+
+QStringList NoteImageCollector::collectedImages()
+{
+    QMutexLocker locker(&s_collectedMutex);
+    return readCollectedImages();
+}
+
+QStringList NoteImageCollector::readCollectedImages()
+{
+    QFile file(collectedListPath());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QStringList();
+    }
+    
+    QStringList paths;
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (!line.isEmpty()) {
+            paths.append(line);
+        }
+    }
+    
+    return paths;
+}
+
+void NoteImageCollector::forgetCollectedImages(const QStringList &paths)
+{
+    if (paths.isEmpty()) {
+        return;
+    }
+    
+    QMutexLocker locker(&s_collectedMutex);
+    QStringList remaining = readCollectedImages();
+    for (const QString &path : paths) {
+        remaining.removeAll(path);
+    }
+    
+    if (remaining.isEmpty()) {
+        QFile::remove(collectedListPath());
+    } else {
+        writeCollectedImages(remaining);
+    }
+}
+
+bool NoteImageCollector::writeCollectedImages(const QStringList &paths)
+{
+    QFile file(collectedListPath());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qDebug() << "无法写入图片回收记录: " << file.errorString();
+        return false;
+    }
+    
+    QTextStream out(&file);
+    for (const QString &path : paths) {
+        out << path << "\n";
+    }
+    
+    return true;
+}
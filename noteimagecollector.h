@@ -0,0 +1,97 @@
+#ifndef NOTEIMAGECOLLECTOR_H
+#define NOTEIMAGECOLLECTOR_H
+
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include "notestatementcache.h"
+
+class NoteConnectionPool;
+class NoteWriter;
+
+// 图片回收
+// 后台线程中定期执行的标记-清除：
+// - 标记：分批读取所有便签的内容，记录其中引用的图片；
+// - 清除：遍历images目录，删除没有被任何便签引用、且释放已超过宽限期的图片文件。
+// 每次只处理一小批，批次之间回到事件循环，不会长时间占用数据库或磁盘。
+// 宽限期从图片不再被引用的时间算起（image_blobs.release_time，由引用表的触发器记录），
+// 便签中删掉的图片在宽限期内撤销删除仍然可以恢复。图片以image_refs登记的键判断（见NoteImageStore::referenceKey），
+// 旧版本按便签分目录保存的图片同样登记引用。没有登记的文件（尚未保存的粘贴、旧版本留下的图片）
+// 在首次发现时记录释放时间，宽限期从此时开始。
+// 标记分多批读取，不是一致的快照；删除前以数据库中当前的引用数和释放时间为准，
+// 标记结果只用于保护尚未重新保存、引用还没有登记的旧便签（其内容在标记之后没有变化）。
+// 读取使用连接池中本线程的读连接，记录释放时间、删除图片记录交给写线程。
+// 删除的文件会记录下来，同步时据此删除远程的副本，避免再次下载回来。
+// 对象需移动到独立线程中运行。
+class NoteImageCollector : public QObject
+{
+    Q_OBJECT
+public:
+    NoteImageCollector(NoteConnectionPool *readers, NoteWriter *writer, QObject *parent = nullptr);
+    
+    // 已回收但尚未从远程删除的图片（相对images目录的路径）
+    static QStringList collectedImages();
+    // 远程副本已处理后移除记录
+    static void forgetCollectedImages(const QStringList &paths);
+
+public slots:
+    // 在回收线程中启动/停止（停止后不再访问数据库和图片目录）
+    void start();
+    void stop();
+    
+    // 立即开始一轮回收
+    void collect();
+
+private slots:
+    void runSlice();
+
+private:
+    enum Phase {
+        Idle,
+        Marking,
+        Sweeping
+    };
+    
+    // 图片在数据库中的引用状态
+    enum ReleaseState {
+        Referenced,     // 仍被引用（或无法确认）
+        Unreleased,     // 没有登记或没有释放时间，需要从现在开始计算宽限期
+        InGracePeriod,  // 释放不久
+        Released        // 释放已超过宽限期，可以删除
+    };
+    
+    void markSlice();
+    void sweepSlice();
+    void finishCycle();
+    ReleaseState releaseState(NoteStatementCache &statements, const QString &key);
+    static QString collectedListPath();
+    static QStringList readCollectedImages();
+    static bool writeCollectedImages(const QStringList &paths);
+    
+    // 每批标记的便签数、每批检查的文件数
+    static const int MarkBatchSize = 50;
+    static const int SweepBatchSize = 100;
+    // 批次之间的间隔
+    static const int SliceIntervalMs = 20;
+    // 启动后首次回收的延迟，以及两轮回收之间的间隔
+    static const int InitialDelayMs = 60 * 1000;
+    static const int CycleIntervalMs = 30 * 60 * 1000;
+    // 宽限期：不再被引用的图片在此之后才会被删除；修改时间在此之内的文件（刚粘贴、刚重新使用、刚同步下载）也不会被删除
+    static const int GracePeriodSecs = 60 * 60;
+    
+    NoteConnectionPool *m_readers;
+    NoteWriter *m_writer;
+    QTimer *m_sliceTimer;
+    QTimer *m_cycleTimer;
+    
+    Phase m_phase;
+    int m_markCursor;           // 已标记的最大便签ID
+    QSet<QString> m_marked;     // 被引用的图片（相对images目录的路径）
+    QStringList m_sweepQueue;   // 待检查的图片文件（相对路径）
+    QStringList m_collected;    // 本轮删除的图片（相对路径）
+    int m_removedFiles;
+    qint64 m_removedBytes;
+};
+
+#endif // NOTEIMAGECOLLECTOR_H
@@ -0,0 +1,128 @@
+#include "noteimagestore.h"
+#include "notedatabase.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QRegularExpression>
+#include <QDebug>
+
+namespace {
+// 内容中引用图片的形式为 .../images/blobs/<64位十六进制哈希>.png
+const QRegularExpression &blobReferencePattern()
+{
+    static const QRegularExpression pattern("images/blobs/([0-9a-f]{64})\\.png");
+    return pattern;
+}
+}
+
+QString NoteImageStore::imagesDirectory()
+{
+    return NoteDatabase::getDatabaseDir() + "/images";
+}
+
+QString NoteImageStore::blobDirectory()
+{
+    return imagesDirectory() + "/blobs";
+}
+
+QString NoteImageStore::blobPath(const QString &hash)
+{
+    return QString("%1/%2.png").arg(blobDirectory(), hash);
+}
+
+bool NoteImageStore::isBlobPath(const QString &path)
+{
+    return blobReferencePattern().match(path).hasMatch();
+}
+
+QString NoteImageStore::store(const QImage &image)
+{
+    // 先编码再计算哈希，相同的图片得到相同的文件名
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    buffer.close();
+    
+    QString hash = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+    QString filePath = blobPath(hash);
+    
+    if (QFile::exists(filePath)) {
+        // 更新修改时间：图片可能已不再被引用，重新使用后在宽限期内不会被回收
+        QFile file(filePath);
+        if (file.open(QIODevice::ReadWrite)) {
+            file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        }
+        return filePath;
+    }
+    
+    QDir dir;
+    if (!dir.exists(blobDirectory())) {
+        dir.mkpath(blobDirectory());
+    }
+    
+    // 先写临时文件再改名，其他进程或同步不会读到写了一半的图片
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qDebug() << "保存图片失败: " << filePath << file.errorString();
+    }
+    
+    return filePath;
+}
+
+QString NoteImageStore::blobHash(const QString &relativePath)
+{
+    static const QRegularExpression pattern("^blobs/([0-9a-f]{64})\\.png$");
+    
+    QRegularExpressionMatch match = pattern.match(relativePath);
+    return match.hasMatch() ? match.captured(1) : QString();
+}
+
+QStringList NoteImageStore::referencedImages(const QString &content)
+{
+    static const QRegularExpression sourcePattern("<img[^>]*\\ssrc=\"([^\"]*)\"");
+    
+    QStringList images;
+    
+    QRegularExpressionMatchIterator it = sourcePattern.globalMatch(content);
+    while (it.hasNext()) {
+        QString source = it.next().captured(1);
+        source.replace("&amp;", "&");
+        
+        // 取images目录之后的部分，绝对路径可能来自另一台同步的电脑
+        qsizetype pos = source.lastIndexOf("/images/");
+        if (pos < 0) {
+            continue;
+        }
+        
+        QString relativePath = source.mid(pos + 8);
+        if (!images.contains(relativePath)) {
+            images.append(relativePath);
+        }
+    }
+    
+    return images;
+}
+
+QString NoteImageStore::referenceKey(const QString &relativePath)
+{
+    QString hash = blobHash(relativePath);
+    return hash.isEmpty() ? relativePath : hash;
+}
+
+QStringList NoteImageStore::referenceKeys(const QString &content)
+{
+    QStringList keys;
+    
+    for (const QString &image : referencedImages(content)) {
+        QString key = referenceKey(image);
+        if (!keys.contains(key)) {
+            keys.append(key);
+        }
+    }
+    
+    return keys;
+}
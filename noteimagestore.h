@@ -0,0 +1,42 @@
+#ifndef NOTEIMAGESTORE_H
+#define NOTEIMAGESTORE_H
+
+#include <QString>
+#include <QStringList>
+#include <QImage>
+
+// 图片存储
+// 图片按内容寻址：以PNG数据的SHA-256作为文件名保存在 images/blobs/ 下，
+// 同一张图片无论粘贴到多少个便签中都只保存、缓存和同步一次。
+// 文件一旦写入就不再修改；便签对图片的引用记录在数据库的image_refs表中（见NoteDatabase）。
+// 旧版本按便签分目录保存的图片（images/<便签ID>/）同样登记引用，以相对路径作为键。
+class NoteImageStore
+{
+public:
+    // 保存图片，返回图片文件路径；相同内容的图片已存在时直接返回其路径
+    static QString store(const QImage &image);
+    
+    // 图片根目录（images），以及其中的图片存储目录（images/blobs）
+    static QString imagesDirectory();
+    static QString blobDirectory();
+    
+    // 指定哈希对应的图片文件路径
+    static QString blobPath(const QString &hash);
+    
+    // 路径是否指向图片存储中的文件
+    static bool isBlobPath(const QString &path);
+    
+    // 相对images目录的路径对应的图片哈希，不是图片存储中的文件时返回空字符串
+    static QString blobHash(const QString &relativePath);
+    
+    // 相对images目录的路径在image_refs中登记的键：图片存储中的文件为哈希，其他图片为相对路径本身
+    static QString referenceKey(const QString &relativePath);
+    
+    // 提取便签内容中引用的所有图片的键（去重）
+    static QStringList referenceKeys(const QString &content);
+    
+    // 提取便签内容中引用的所有图片，返回相对images目录的路径（包括旧版本按便签分目录保存的图片）
+    static QStringList referencedImages(const QString &content);
+};
+
+#endif // NOTEIMAGESTORE_H
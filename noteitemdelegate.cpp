@@ -0,0 +1,209 @@
+#include "noteitemdelegate.h"
+#include "notelistmodel.h"
+#include <QPainter>
+#include <QPaintDevice>
+#include <QPixmapCache>
+#include <QtMath>
+
+NoteItemDelegate::NoteItemDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+    , m_fontsReady(false)
+    , m_titleMetrics(QFont())
+    , m_timeMetrics(QFont())
+    , m_titles(TextCacheSize)
+    , m_times(TextCacheSize)
+{
+}
+
+void NoteItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    // 只用到行的位置、状态和字体，不需要initStyleOption准备的图标、文本等
+    bool selected = option.state & QStyle::State_Selected;
+    updateFonts(option.font);
+    
+    painter->save();
+    
+    // 设置卡片边距
+    QRect cardRect = option.rect.adjusted(CardMargin, CardMargin/2, -CardMargin, -CardMargin/2);
+    
+    // 绘制卡片：阴影、背景（考虑选中状态）和边框都在源图中
+    int shadow = ShadowLayers - 1;
+    QRect chromeRect = cardRect.adjusted(0, 0, shadow, shadow);
+    if (cardRect.width() > 2 * CardSlice && cardRect.height() > 2 * CardSlice) {
+        qreal devicePixelRatio = painter->device() ? painter->device()->devicePixelRatio() : 1.0;
+        drawNineSlice(painter, chromeRect, cardPixmap(selected, devicePixelRatio),
+                      CardSlice, CardSlice, CardSlice + shadow, CardSlice + shadow);
+    } else {
+        drawCard(painter, cardRect, selected);
+    }
+    
+    int noteId = index.data(NoteListModel::NoteIdRole).toInt();
+    
+    // 绘制标题
+    QRect titleRect = cardRect;
+    titleRect.setHeight(cardRect.height() / 2);
+    QRect titleTextRect = titleRect.adjusted(15, 8, -10, 0);
+    
+    ElidedText title = elidedText(m_titles, noteId, index.data(Qt::DisplayRole).toString(),
+                                  m_titleMetrics, titleTextRect.width());
+    painter->setFont(m_titleFont);
+    painter->setPen(QColor(50, 50, 50));
+    painter->drawStaticText(titleTextRect.left(),
+                            titleTextRect.top() + (titleTextRect.height() - m_titleMetrics.height()) / 2,
+                            title.staticText);
+    
+    // 绘制时间（右对齐）
+    QRect timeRect = cardRect;
+    timeRect.setTop(titleRect.bottom() - 5);
+    timeRect.setHeight(cardRect.height() / 2);
+    QRect timeTextRect = timeRect.adjusted(15, 0, -10, -5);
+    
+    ElidedText time = elidedText(m_times, noteId, index.data(NoteListModel::TimeTextRole).toString(),
+                                 m_timeMetrics, timeTextRect.width());
+    painter->setFont(m_timeFont);
+    painter->setPen(QColor(128, 128, 128));
+    painter->drawStaticText(timeTextRect.left() + timeTextRect.width() - time.width,
+                            timeTextRect.top() + (timeTextRect.height() - m_timeMetrics.height()) / 2,
+                            time.staticText);
+    
+    painter->restore();
+}
+
+QSize NoteItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QSize size = QStyledItemDelegate::sizeHint(option, index);
+    size.setHeight(ItemHeight); // 增加高度以适应阴影效果
+    return size;
+}
+
+QPixmap NoteItemDelegate::cardPixmap(bool selected, qreal devicePixelRatio)
+{
+    QString key = QString("SimpleNote.noteCard.%1.%2").arg(selected ? 1 : 0).arg(devicePixelRatio);
+    
+    QPixmap pixmap;
+    if (QPixmapCache::find(key, &pixmap)) {
+        return pixmap;
+    }
+    
+    // 最小的卡片：四角加上中间1像素的可拉伸部分，再加阴影
+    int cardSize = 2 * CardSlice + 1;
+    int size = cardSize + ShadowLayers - 1;
+    
+    pixmap = QPixmap(qCeil(size * devicePixelRatio), qCeil(size * devicePixelRatio));
+    pixmap.setDevicePixelRatio(devicePixelRatio);
+    pixmap.fill(Qt::transparent);
+    
+    QPainter painter(&pixmap);
+    drawCard(&painter, QRect(0, 0, cardSize, cardSize), selected);
+    painter.end();
+    
+    QPixmapCache::insert(key, pixmap);
+    return pixmap;
+}
+
+void NoteItemDelegate::drawCard(QPainter *painter, const QRect &cardRect, bool selected)
+{
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    
+    // 绘制阴影效果 - 增强阴影效果，让卡片更具立体感
+    painter->setPen(Qt::NoPen);
+    for (int i = 0; i < ShadowLayers; i++) {
+        QColor shadowColor(0, 0, 0, 30 - i * 5);
+        painter->setBrush(shadowColor);
+        QRect shadowRect = cardRect.adjusted(i, i, i, i);
+        painter->drawRoundedRect(shadowRect, CornerRadius, CornerRadius);
+    }
+    
+    // 绘制卡片背景（考虑选中状态）
+    if (selected) {
+        // 绘制选中状态背景
+        painter->setBrush(QColor("#E3F2FD"));
+        painter->setPen(Qt::NoPen);
+        painter->drawRoundedRect(cardRect, CornerRadius, CornerRadius);
+        
+        // 左侧添加蓝色条 - 使用稍微粗一点的条
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(QColor("#2196F3"));
+        painter->drawRoundedRect(QRect(cardRect.left() + 2, cardRect.top() + 3, 4, cardRect.height() - 6), 2, 2);
+    } else {
+        // 使用白色背景并添加细边框
+        painter->setBrush(QColor("#FFFFFF"));
+        painter->setPen(QPen(QColor("#E0E0E0"), 1));
+        painter->drawRoundedRect(cardRect, CornerRadius, CornerRadius);
+    }
+    
+    painter->restore();
+}
+
+// 按九宫格把源图贴到target：四角原样绘制，四边沿一个方向拉伸，中间双向拉伸
+// 边距为逻辑像素，源图区域按源图的设备像素比换算
+void NoteItemDelegate::drawNineSlice(QPainter *painter, const QRect &target, const QPixmap &pixmap,
+                                     int left, int top, int right, int bottom)
+{
+    qreal ratio = pixmap.devicePixelRatio();
+    int sourceLeft = qRound(left * ratio);
+    int sourceTop = qRound(top * ratio);
+    int sourceRight = qRound(right * ratio);
+    int sourceBottom = qRound(bottom * ratio);
+    
+    qreal sourceX[4] = {0, qreal(sourceLeft), qreal(pixmap.width() - sourceRight), qreal(pixmap.width())};
+    qreal sourceY[4] = {0, qreal(sourceTop), qreal(pixmap.height() - sourceBottom), qreal(pixmap.height())};
+    qreal targetX[4] = {qreal(target.left()), qreal(target.left() + left),
+                        qreal(target.left() + target.width() - right), qreal(target.left() + target.width())};
+    qreal targetY[4] = {qreal(target.top()), qreal(target.top() + top),
+                        qreal(target.top() + target.height() - bottom), qreal(target.top() + target.height())};
+    
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 3; ++column) {
+            QRectF targetRect(QPointF(targetX[column], targetY[row]), QPointF(targetX[column + 1], targetY[row + 1]));
+            QRectF sourceRect(QPointF(sourceX[column], sourceY[row]), QPointF(sourceX[column + 1], sourceY[row + 1]));
+            painter->drawPixmap(targetRect, pixmap, sourceRect);
+        }
+    }
+}
+
+// 字体由列表的字体派生，列表字体变化时重新计算度量并丢弃已省略的文本
+void NoteItemDelegate::updateFonts(const QFont &font) const
+{
+    if (m_fontsReady && font == m_baseFont) {
+        return;
+    }
+    
+    m_baseFont = font;
+    m_fontsReady = true;
+    
+    m_titleFont = font;
+    m_titleFont.setBold(true);
+    m_titleFont.setPointSize(font.pointSize() + 1);
+    m_titleMetrics = QFontMetrics(m_titleFont);
+    
+    m_timeFont = font;
+    m_timeFont.setPointSize(font.pointSize() - 1);
+    m_timeMetrics = QFontMetrics(m_timeFont);
+    
+    m_titles.clear();
+    m_times.clear();
+}
+
+NoteItemDelegate::ElidedText NoteItemDelegate::elidedText(QCache<int, ElidedText> &cache, int noteId, const QString &text,
+                                                          const QFontMetrics &metrics, int availableWidth) const
+{
+    ElidedText *cached = cache.object(noteId);
+    if (cached && cached->availableWidth == availableWidth && cached->text == text) {
+        return *cached;
+    }
+    
+    ElidedText *elided = new ElidedText;
+    elided->text = text;
+    elided->availableWidth = availableWidth;
+    
+    QString shown = metrics.elidedText(text, Qt::ElideRight, availableWidth);
+    elided->width = metrics.horizontalAdvance(shown);
+    elided->staticText.setTextFormat(Qt::PlainText);
+    elided->staticText.setText(shown);
+    
+    ElidedText result = *elided;
+    cache.insert(noteId, elided);
+    return result;
+}
@@ -0,0 +1,65 @@
+#ifndef NOTEITEMDELEGATE_H
+#define NOTEITEMDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QCache>
+#include <QFont>
+#include <QFontMetrics>
+#include <QPixmap>
+#include <QStaticText>
+
+// 便签列表项代理，绘制两行内容（标题和时间）的卡片
+// 卡片外观（阴影、背景、边框、选中条）按选中状态和设备像素比只渲染一次，存入QPixmapCache，
+// 绘制时按九宫格贴到卡片大小；字体、字体度量和省略后的文本也都缓存，
+// 滚动时每一行只需几次贴图和两次静态文本绘制。
+class NoteItemDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    explicit NoteItemDelegate(QObject *parent = nullptr);
+    
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+private:
+    // 省略后的一行文本，原文或可用宽度变化后重新计算
+    struct ElidedText {
+        QString text;
+        int availableWidth = 0;
+        int width = 0;
+        QStaticText staticText;
+    };
+    
+    // 卡片外观的九宫格源图
+    static QPixmap cardPixmap(bool selected, qreal devicePixelRatio);
+    // 直接绘制卡片外观（源图和卡片过小时使用）
+    static void drawCard(QPainter *painter, const QRect &cardRect, bool selected);
+    static void drawNineSlice(QPainter *painter, const QRect &target, const QPixmap &pixmap,
+                              int left, int top, int right, int bottom);
+    
+    void updateFonts(const QFont &font) const;
+    ElidedText elidedText(QCache<int, ElidedText> &cache, int noteId, const QString &text,
+                          const QFontMetrics &metrics, int availableWidth) const;
+    
+    // 卡片与列表项边缘的距离、圆角半径
+    static const int CardMargin = 8;
+    static const int CornerRadius = 6;
+    // 阴影向右下方延伸的层数，每层偏移1像素
+    static const int ShadowLayers = 5;
+    // 九宫格四角不拉伸部分的大小（不含阴影），需容纳圆角和选中条的圆头
+    static const int CardSlice = 12;
+    static const int ItemHeight = 75;
+    // 每种文本最多缓存的行数
+    static const int TextCacheSize = 512;
+    
+    mutable bool m_fontsReady;
+    mutable QFont m_baseFont;
+    mutable QFont m_titleFont;
+    mutable QFont m_timeFont;
+    mutable QFontMetrics m_titleMetrics;
+    mutable QFontMetrics m_timeMetrics;
+    mutable QCache<int, ElidedText> m_titles;
+    mutable QCache<int, ElidedText> m_times;
+};
+
+#endif // NOTEITEMDELEGATE_H
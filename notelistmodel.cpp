@@ -0,0 +1,223 @@
+#include "notelistmodel.h"
+#include "notedatabase.h"
+
+NoteListModel::NoteListModel(NoteDatabase *database, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_database(database)
+    , m_hasMoreNotes(false)
+    , m_isSearchResult(false)
+{
+}
+
+int NoteListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant NoteListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size()) {
+        return QVariant();
+    }
+    
+    const NoteSummary &summary = m_rows.at(index.row());
+    
+    switch (role) {
+    case Qt::DisplayRole: {
+        // 摘要中的标题已在存储层处理（无标题便签取内容第一行），仍为空时显示"无标题"
+        QString title = summary.title;
+        if (title.isEmpty()) {
+            title = "无标题";
+        }
+        
+        // 限制标题长度
+        if (title.length() > 30) {
+            title = title.left(30) + "...";
+        }
+        return title;
+    }
+    
+    case Qt::ToolTipRole: {
+        // 搜索结果的命中摘要显示在提示中，命中的文本加粗
+        if (summary.snippet.isEmpty()) {
+            return QVariant();
+        }
+        QString snippet = summary.snippet.toHtmlEscaped();
+        snippet.replace(NoteSummary::HighlightBegin, "<b>");
+        snippet.replace(NoteSummary::HighlightEnd, "</b>");
+        return snippet;
+    }
+    
+    case NoteIdRole:
+        return summary.id;
+    
+    case TimeTextRole:
+        return summary.updateTime.toString("MM-dd HH:mm");
+    }
+    
+    return QVariant();
+}
+
+bool NoteListModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_hasMoreNotes;
+}
+
+void NoteListModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() || !m_hasMoreNotes) {
+        return;
+    }
+    
+    QList<NoteSummary> summaries = m_database->getNotesPage(m_pageCursor, PageSize);
+    m_hasMoreNotes = summaries.size() == PageSize;
+    
+    if (summaries.isEmpty()) {
+        return;
+    }
+    
+    m_pageCursor = NotePageCursor::after(summaries.last());
+    
+    beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size() + summaries.size() - 1);
+    m_rows.append(summaries);
+    endInsertRows();
+}
+
+void NoteListModel::reload()
+{
+    beginResetModel();
+    m_rows.clear();
+    m_pageCursor = NotePageCursor();
+    m_hasMoreNotes = true;
+    m_isSearchResult = false;
+    endResetModel();
+    
+    // 先读第一页，其余在视图滚动到末尾时读取
+    fetchMore(QModelIndex());
+}
+
+void NoteListModel::setSearchResults(const QList<NoteSummary> &results)
+{
+    beginResetModel();
+    m_rows = results;
+    m_hasMoreNotes = false;
+    m_isSearchResult = true;
+    endResetModel();
+}
+
+void NoteListModel::appendSearchResults(const QList<NoteSummary> &results)
+{
+    if (results.isEmpty()) {
+        return;
+    }
+    
+    beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size() + results.size() - 1);
+    m_rows.append(results);
+    endInsertRows();
+}
+
+int NoteListModel::noteIdAt(int row) const
+{
+    if (row < 0 || row >= m_rows.size()) {
+        return -1;
+    }
+    
+    return m_rows.at(row).id;
+}
+
+int NoteListModel::rowOf(int noteId) const
+{
+    for (int row = 0; row < m_rows.size(); ++row) {
+        if (m_rows.at(row).id == noteId) {
+            return row;
+        }
+    }
+    
+    return -1;
+}
+
+void NoteListModel::updateNote(const NoteSummary &summary)
+{
+    int row = rowOf(summary.id);
+    
+    if (m_isSearchResult) {
+        // 搜索结果只更新已有的行，保留命中摘要；新便签不一定匹配，不插入
+        if (row >= 0) {
+            QString snippet = m_rows.at(row).snippet;
+            m_rows[row] = summary;
+            m_rows[row].snippet = snippet;
+            emit dataChanged(index(row), index(row));
+        }
+        return;
+    }
+    
+    // 新位置在分页游标之后：由之后的分页读取，这里不显示
+    bool pending = m_hasMoreNotes && m_pageCursor.isValid() &&
+                   (summary.updateTime < m_pageCursor.updateTime ||
+                    (summary.updateTime == m_pageCursor.updateTime && summary.id < m_pageCursor.id));
+    if (pending) {
+        if (row >= 0) {
+            beginRemoveRows(QModelIndex(), row, row);
+            m_rows.removeAt(row);
+            endRemoveRows();
+        }
+        return;
+    }
+    
+    int target = positionOf(summary, row);
+    
+    if (row < 0) {
+        beginInsertRows(QModelIndex(), target, target);
+        m_rows.insert(target, summary);
+        endInsertRows();
+        return;
+    }
+    
+    if (target != row) {
+        // 目标位置按移动前的行号计算：向下移动时要越过自身
+        beginMoveRows(QModelIndex(), row, row, QModelIndex(), target > row ? target + 1 : target);
+        m_rows.move(row, target);
+        endMoveRows();
+    }
+    
+    m_rows[target] = summary;
+    emit dataChanged(index(target), index(target));
+}
+
+void NoteListModel::removeNote(int noteId)
+{
+    int row = rowOf(noteId);
+    if (row < 0) {
+        return;
+    }
+    
+    beginRemoveRows(QModelIndex(), row, row);
+    m_rows.removeAt(row);
+    endRemoveRows();
+}
+
+bool NoteListModel::isBefore(const NoteSummary &a, const NoteSummary &b)
+{
+    if (a.updateTime != b.updateTime) {
+        return a.updateTime > b.updateTime;
+    }
+    
+    return a.id > b.id;
+}
+
+int NoteListModel::positionOf(const NoteSummary &summary, int skipRow) const
+{
+    // 刚保存的便签通常排在最前，从头查找很快结束
+    int position = 0;
+    for (int row = 0; row < m_rows.size(); ++row) {
+        if (row == skipRow) {
+            continue;
+        }
+        if (isBefore(summary, m_rows.at(row))) {
+            break;
+        }
+        ++position;
+    }
+    
+    return position;
+}
@@ -0,0 +1,64 @@
+#ifndef NOTELISTMODEL_H
+#define NOTELISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+#include "note.h"
+
+class NoteDatabase;
+
+// 便签列表模型
+// 每行只保存便签摘要（标题、时间、字数等），不保存完整内容。
+// 浏览时按页从数据库读取：视图滚动到末尾时通过fetchMore()读取下一页；
+// 搜索结果由后台搜索分批给出，不再分页。
+// 保存、删除便签后用updateNote()/removeNote()局部更新，不必重新加载：
+// 已加载的行按(更新时间, ID)倒序排列，保存过的便签移到新的位置，选中状态随行移动。
+class NoteListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Roles {
+        NoteIdRole = Qt::UserRole,  // 便签ID
+        TimeTextRole                // 显示用的更新时间
+    };
+    
+    explicit NoteListModel(NoteDatabase *database, QObject *parent = nullptr);
+    
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    
+    // 清空并重新读取第一页
+    void reload();
+    // 显示搜索结果（按相关度排序，不分页）
+    void setSearchResults(const QList<NoteSummary> &results);
+    // 在末尾追加同一次搜索的下一批结果
+    void appendSearchResults(const QList<NoteSummary> &results);
+    
+    int noteIdAt(int row) const;
+    int rowOf(int noteId) const;
+    
+    // 便签保存后更新其所在的行（新便签插入到对应位置）
+    void updateNote(const NoteSummary &summary);
+    // 便签删除后移除其所在的行
+    void removeNote(int noteId);
+    
+    // 每页读取的便签数量
+    static const int PageSize = 50;
+
+private:
+    // 按(更新时间, ID)倒序，a是否排在b之前
+    static bool isBefore(const NoteSummary &a, const NoteSummary &b);
+    // 摘要在已加载的行中应处的位置（不计skipRow）
+    int positionOf(const NoteSummary &summary, int skipRow) const;
+    
+    NoteDatabase *m_database;
+    QList<NoteSummary> m_rows;
+    NotePageCursor m_pageCursor;
+    bool m_hasMoreNotes;
+    bool m_isSearchResult;  // 搜索结果按相关度排序，局部更新时不调整顺序
+};
+
+#endif // NOTELISTMODEL_H
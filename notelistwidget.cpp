@@ -10,32 +10,41 @@
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QAction>
+#include <QThread>
 
 NoteListWidget::NoteListWidget(QWidget *parent) :
     QWidget(parent),
     ui(new Ui::NoteListWidget),
-    m_database(new NoteDatabase(this)),
-    m_searchTimer(new QTimer(this))
+    m_database(NoteDatabase::instance()),
+    m_searchTimer(new QTimer(this)),
+    m_model(new NoteListModel(NoteDatabase::instance(), this)),
+    m_searchThread(new QThread(this)),
+    m_searcher(new NoteSearcher(NoteDatabase::instance())),
+    m_searchGeneration(0),
+    m_hasSearchResults(false)
 {
     ui->setupUi(this);
     
+    // 列表只保存摘要，按页读取；所有行高度相同（uniformItemSizes），视图无需逐行计算尺寸
+    ui->noteListView->setModel(m_model);
+    
     // 设置列表项显示两行
-    ui->noteListWidget->setItemDelegate(new NoteItemDelegate(this));
+    ui->noteListView->setItemDelegate(new NoteItemDelegate(this));
     
     // 设置列表控件样式 - 透明背景，更好地展示卡片效果
-    ui->noteListWidget->setStyleSheet(
-        "QListWidget { "
+    ui->noteListView->setStyleSheet(
+        "QListView { "
         "  background-color: #F5F5F5; "
         "  border: none; "
         "  outline: none; "
         "  padding: 5px; "
         "}"
-        "QListWidget::item { "
+        "QListView::item { "
         "  background-color: transparent; "
         "  border: none; "
         "  margin: 3px 0px; "
         "}"
-        "QListWidget::item:selected { "
+        "QListView::item:selected { "
         "  background-color: transparent; "
         "  border: none; "
         "}"
@@ -92,21 +101,29 @@ NoteListWidget::NoteListWidget(QWidget *parent) :
     searchAction->setIcon(QIcon::fromTheme("edit-find", QIcon(":/icons/search.png")));
     ui->searchLineEdit->addAction(searchAction, QLineEdit::LeadingPosition);
     
-    // 设置搜索延迟
+    // 设置搜索延迟，搜索在后台执行，新的输入会取消之前的搜索
     m_searchTimer->setSingleShot(true);
-    m_searchTimer->setInterval(300); // 300ms延迟
+    m_searchTimer->setInterval(100); // 100ms延迟
+    
+    // 搜索线程，结果以排队方式回到界面线程
+    m_searchThread->setObjectName("NoteSearcher");
+    m_searcher->moveToThread(m_searchThread);
+    connect(m_searchThread, &QThread::finished, m_searcher, &QObject::deleteLater);
+    connect(m_searcher, &NoteSearcher::resultsReady, this, &NoteListWidget::onSearchResultsReady);
+    connect(m_searcher, &NoteSearcher::searchFinished, this, &NoteListWidget::onSearchFinished);
+    m_searchThread->start();
     
     // 设置主窗口样式
     setStyleSheet("QWidget { background-color: #F5F5F5; }");
     
     // 连接信号和槽
     connect(ui->addButton, &QPushButton::clicked, this, &NoteListWidget::onAddButtonClicked);
-    connect(ui->noteListWidget, &QListWidget::itemClicked, this, &NoteListWidget::onNoteItemClicked);
+    connect(ui->noteListView, &QListView::clicked, this, &NoteListWidget::onNoteItemClicked);
     connect(ui->searchLineEdit, &QLineEdit::textChanged, this, &NoteListWidget::onSearchTextChanged);
     connect(m_searchTimer, &QTimer::timeout, this, &NoteListWidget::performSearch);
     
-    // 打开数据库
-    if (!m_database->open()) {
+    // 共享的存储服务已由main()打开
+    if (!m_database->isOpen()) {
         // 处理数据库打开失败
         ui->emptyTextLabel->setText("无法打开数据库");
     }
@@ -117,26 +134,49 @@ NoteListWidget::NoteListWidget(QWidget *parent) :
 
 NoteListWidget::~NoteListWidget()
 {
+    // 正在进行的搜索在下一批结果之前停止
+    m_searcher->cancel();
+    m_searchThread->quit();
+    m_searchThread->wait();
+    
     delete ui;
 }
 
 void NoteListWidget::refreshNoteList()
 {
-    ui->noteListWidget->clear();
+    // 丢弃尚未显示的搜索结果
+    m_searchGeneration = m_searcher->cancel();
+    
+    // 只加载第一页，其余在滚动到底部时由视图调用fetchMore()继续加载
+    m_model->reload();
     
-    QList<Note> notes = m_database->getAllNotes();
-    for (const Note &note : notes) {
-        addNoteToList(note);
+    updateEmptyStateVisibility();
+}
+
+void NoteListWidget::updateNote(int noteId)
+{
+    NoteSummary summary = m_database->getNoteSummary(noteId);
+    if (summary.id == -1) {
+        m_model->removeNote(noteId);
+    } else {
+        m_model->updateNote(summary);
     }
     
     updateEmptyStateVisibility();
 }
 
+void NoteListWidget::removeNote(int noteId)
+{
+    m_model->removeNote(noteId);
+    
+    updateEmptyStateVisibility();
+}
+
 Note NoteListWidget::getCurrentNote() const
 {
-    QListWidgetItem *currentItem = ui->noteListWidget->currentItem();
-    if (currentItem) {
-        return Note::fromVariant(currentItem->data(Qt::UserRole));
+    int noteId = m_model->noteIdAt(ui->noteListView->currentIndex().row());
+    if (noteId > 0) {
+        return m_database->getNote(noteId);
     }
     
     return Note();
@@ -147,11 +187,10 @@ void NoteListWidget::onAddButtonClicked()
     emit createNewNote();
 }
 
-void NoteListWidget::onNoteItemClicked(QListWidgetItem *item)
+void NoteListWidget::onNoteItemClicked(const QModelIndex &index)
 {
-    if (item) {
-        Note note = Note::fromVariant(item->data(Qt::UserRole));
-        emit noteSelected(note);
+    if (index.isValid()) {
+        emit noteSelected(index.data(NoteListModel::NoteIdRole).toInt());
     }
 }
 
@@ -163,72 +202,49 @@ void NoteListWidget::onSearchTextChanged(const QString &text)
 
 void NoteListWidget::performSearch()
 {
-    ui->noteListWidget->clear();
-    
     if (m_lastSearchText.isEmpty()) {
         refreshNoteList();
         return;
     }
     
-    QList<Note> notes = m_database->searchNotes(m_lastSearchText);
-    for (const Note &note : notes) {
-        addNoteToList(note);
+    // 之前的列表保留到第一批结果到达
+    m_searchGeneration = m_searcher->startSearch(m_lastSearchText);
+    m_hasSearchResults = false;
+}
+
+void NoteListWidget::onSearchResultsReady(quint64 generation, const QList<NoteSummary> &batch)
+{
+    if (generation != m_searchGeneration) {
+        return;
+    }
+    
+    if (m_hasSearchResults) {
+        m_model->appendSearchResults(batch);
+    } else {
+        m_model->setSearchResults(batch);
+        m_hasSearchResults = true;
     }
     
     updateEmptyStateVisibility();
 }
 
-void NoteListWidget::addNoteToList(const Note &note)
+void NoteListWidget::onSearchFinished(quint64 generation)
 {
-    QListWidgetItem *item = new QListWidgetItem(ui->noteListWidget);
-    
-    // 设置显示内容 - 使用纯文本，不使用HTML
-    // 对标题进行处理：如果内容为HTML则提取纯文本，限制长度，防止过长
-    QString content = note.content();
-    QString title = note.title();
-    
-    // 如果标题为空，尝试从内容中提取第一行作为标题
-    if (title.isEmpty()) {
-        // 如果内容是HTML，尝试提取纯文本
-        if (content.contains("<html>") || content.contains("<body>")) {
-            QTextDocument doc;
-            doc.setHtml(content);
-            content = doc.toPlainText();
-        }
-        
-        // 使用内容的第一行作为标题
-        title = content.split("\n").first().trimmed();
-        
-        // 如果标题仍然为空，使用"无标题"
-        if (title.isEmpty()) {
-            title = "无标题";
-        }
+    if (generation != m_searchGeneration) {
+        return;
     }
     
-    // 限制标题长度
-    if (title.length() > 30) {
-        title = title.left(30) + "...";
+    // 没有任何结果
+    if (!m_hasSearchResults) {
+        m_model->setSearchResults(QList<NoteSummary>());
     }
     
-    // 设置时间格式
-    QString timeStr = note.updateTime().toString("MM-dd HH:mm");
-    
-    // 设置纯文本标题
-    item->setText(title);
-    
-    // 设置时间为子项
-    item->setData(Qt::UserRole + 1, timeStr);
-    item->setData(Qt::UserRole, note.toVariant());
-    
-    // 设置项目高度 - 增加高度以容纳卡片和阴影
-    item->setSizeHint(QSize(ui->noteListWidget->width(), 75));
-    
-    ui->noteListWidget->addItem(item);
+    updateEmptyStateVisibility();
 }
 
 void NoteListWidget::updateEmptyStateVisibility()
 {
-    bool isEmpty = ui->noteListWidget->count() == 0;
+    bool isEmpty = m_model->rowCount() == 0;
     
     if (isEmpty) {
         // 如果列表为空，根据搜索状态显示不同的提示
@@ -242,5 +258,5 @@ void NoteListWidget::updateEmptyStateVisibility()
     }
     
     ui->emptyStateWidget->setVisible(isEmpty);
-    ui->noteListWidget->setVisible(!isEmpty);
+    ui->noteListView->setVisible(!isEmpty);
 } 
\ No newline at end of file
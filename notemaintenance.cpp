@@ -0,0 +1,192 @@
+#include "notemaintenance.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDebug>
+
+NoteMaintenance::NoteMaintenance()
+    : m_phase(Idle)
+    , m_startPageCount(0)
+    , m_pageSize(0)
+{
+}
+
+void NoteMaintenance::begin(const QSqlDatabase &db)
+{
+    m_db = db;
+    m_report = NoteMaintenanceReport();
+    m_startPageCount = pragmaValue(m_db, "page_count");
+    m_pageSize = pragmaValue(m_db, "page_size");
+    
+    // auto_vacuum：0为不回收，1为自动回收，2为增量回收
+    if (pragmaValue(m_db, "auto_vacuum") == 2) {
+        m_phase = Vacuuming;
+    } else if (m_startPageCount * m_pageSize <= ConvertMaxBytes) {
+        m_phase = Converting;
+    } else {
+        // 较大的库在维护中不切换（完整VACUUM会长时间占用写连接），报告空闲空间，由用户决定是否压缩
+        m_report.compactionNeeded = true;
+        m_report.freeBytes = pragmaValue(m_db, "freelist_count") * m_pageSize;
+        m_phase = Analyzing;
+    }
+}
+
+void NoteMaintenance::prepareNewDatabase(QSqlDatabase &db)
+{
+    // 必须在写入任何内容（包括切换WAL）之前设置
+    if (pragmaValue(db, "page_count") > 0) {
+        return;
+    }
+    
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA auto_vacuum = INCREMENTAL")) {
+        qDebug() << "设置增量回收模式失败: " << query.lastError().text();
+    }
+}
+
+bool NoteMaintenance::step()
+{
+    QElapsedTimer timer;
+    timer.start();
+    
+    switch (m_phase) {
+    case Idle:
+        return false;
+    
+    case Converting:
+        // 完整VACUUM同时回收了全部空闲页，不再需要分批回收
+        convert();
+        m_report.convertMs = timer.elapsed();
+        m_phase = Analyzing;
+        return true;
+    
+    case Vacuuming:
+        if (!vacuumStep()) {
+            m_phase = Analyzing;
+        }
+        m_report.vacuumMs += timer.elapsed();
+        return true;
+    
+    case Analyzing: {
+        // 限制每个索引分析的行数，大库上也能很快完成
+        QSqlQuery query(m_db);
+        query.exec("PRAGMA analysis_limit = 400");
+        if (!query.exec("PRAGMA optimize")) {
+            qDebug() << "更新统计信息失败: " << query.lastError().text();
+        }
+        m_report.analyzeMs = timer.elapsed();
+        m_phase = Checking;
+        return true;
+    }
+    
+    case Checking:
+        check();
+        m_report.checkMs = timer.elapsed();
+        m_report.reclaimedBytes = qMax<qint64>(0, (m_startPageCount - pragmaValue(m_db, "page_count")) * m_pageSize);
+        m_phase = Idle;
+        m_db = QSqlDatabase();
+        return false;
+    }
+    
+    return false;
+}
+
+// 切换为增量回收模式，只对不超过ConvertMaxBytes的库执行，耗时有上限
+bool NoteMaintenance::convert()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec("PRAGMA auto_vacuum = INCREMENTAL") || !query.exec("VACUUM")) {
+        qDebug() << "切换增量回收模式失败: " << query.lastError().text();
+        return false;
+    }
+    
+    return true;
+}
+
+// 回收一批空闲页，返回false表示已没有空闲页
+// 通过Qt执行时语句只前进一步，每次只释放一页，因此在一个事务中重复执行
+bool NoteMaintenance::vacuumStep()
+{
+    qint64 freePages = pragmaValue(m_db, "freelist_count");
+    if (freePages <= 0) {
+        return false;
+    }
+    
+    QElapsedTimer timer;
+    timer.start();
+    
+    bool inTransaction = m_db.transaction();
+    
+    QSqlQuery query(m_db);
+    if (!query.prepare("PRAGMA incremental_vacuum")) {
+        qDebug() << "回收空闲页失败: " << query.lastError().text();
+        if (inTransaction) {
+            m_db.rollback();
+        }
+        return false;
+    }
+    
+    int pages = 0;
+    bool ok = true;
+    while (pages < freePages && pages < VacuumPagesPerStep && timer.elapsed() < StepBudgetMs) {
+        if (!query.exec()) {
+            qDebug() << "回收空闲页失败: " << query.lastError().text();
+            ok = false;
+            break;
+        }
+        query.finish();
+        ++pages;
+    }
+    
+    if (inTransaction && !m_db.commit()) {
+        qDebug() << "回收空闲页提交失败: " << m_db.lastError().text();
+        m_db.rollback();
+        ok = false;
+    }
+    
+    return ok && pages < freePages;
+}
+
+void NoteMaintenance::check()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec("PRAGMA quick_check")) {
+        qDebug() << "完整性检查失败: " << query.lastError().text();
+        return;
+    }
+    
+    // 检查通过时只返回一行"ok"，否则每行一条错误
+    if (query.next()) {
+        QString result = query.value(0).toString();
+        if (result != "ok") {
+            m_report.integrityOk = false;
+            m_report.integrityMessage = result;
+        }
+    }
+}
+
+void NoteMaintenance::cancel()
+{
+    m_phase = Idle;
+    m_db = QSqlDatabase();
+}
+
+bool NoteMaintenance::isRunning() const
+{
+    return m_phase != Idle;
+}
+
+const NoteMaintenanceReport &NoteMaintenance::report() const
+{
+    return m_report;
+}
+
+qint64 NoteMaintenance::pragmaValue(const QSqlDatabase &db, const QString &name)
+{
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA " + name) || !query.next()) {
+        return 0;
+    }
+    
+    return query.value(0).toLongLong();
+}
@@ -0,0 +1,79 @@
+#ifndef NOTEMAINTENANCE_H
+#define NOTEMAINTENANCE_H
+
+#include <QString>
+#include <QMetaType>
+#include <QSqlDatabase>
+
+// 一轮维护的结果
+struct NoteMaintenanceReport
+{
+    qint64 reclaimedBytes = 0;  // 数据库文件缩小的字节数
+    qint64 convertMs = 0;       // 切换为增量回收模式的耗时（只在首次维护时发生）
+    qint64 vacuumMs = 0;        // 回收空闲页耗时
+    qint64 analyzeMs = 0;       // 更新统计信息耗时
+    qint64 checkMs = 0;         // 完整性检查耗时
+    bool integrityOk = true;
+    QString integrityMessage;   // 检查不通过时的第一条错误
+    bool compactionNeeded = false;  // 数据库较大、尚未切换回收模式，需要压缩（见NoteDatabase::startCompaction）
+    qint64 freeBytes = 0;           // 需要压缩时空闲页占用的字节数
+};
+
+Q_DECLARE_METATYPE(NoteMaintenanceReport)
+
+// 数据库维护
+// 大量删除便签、图片后，数据库中会留下空闲页，文件不会自动变小（同步时要整体上传）。
+// 一轮维护依次执行：
+// - 切换回收模式：旧版本创建的库不是增量回收模式，需要一次完整VACUUM；
+//   不超过ConvertMaxBytes的库在首次维护时直接切换（写线程空闲时执行，期间的保存在队列中等待），
+//   更大的库不在维护中切换，只在报告中标记需要压缩，由用户触发的压缩完成切换；
+// - 回收空闲页：每一步只回收一小批空闲页（仅限增量回收模式的数据库）；
+// - PRAGMA optimize：按需更新查询规划使用的统计信息（限制分析行数）；
+// - PRAGMA quick_check：快速完整性检查。
+// 每次调用step()只执行一小步，调用者在步与步之间回到事件循环，不会长时间占用写连接。
+// 需要在可写的连接上运行，由写线程在空闲时驱动（见NoteWriter）。
+class NoteMaintenance
+{
+public:
+    NoteMaintenance();
+    
+    // 新建的空库直接设置为增量回收模式（建表之前设置即可，不需要VACUUM），已有的库不做处理
+    static void prepareNewDatabase(QSqlDatabase &db);
+    
+    // 维护中直接切换回收模式的最大文件大小
+    static const qint64 ConvertMaxBytes = 16 * 1024 * 1024;
+    
+    void begin(const QSqlDatabase &db);
+    // 执行一步，返回false表示本轮维护已结束
+    bool step();
+    void cancel();
+    bool isRunning() const;
+    
+    const NoteMaintenanceReport &report() const;
+
+private:
+    enum Phase {
+        Idle,
+        Converting,  // 切换为增量回收模式
+        Vacuuming,   // 分批回收空闲页
+        Analyzing,   // 更新统计信息
+        Checking     // 完整性检查
+    };
+    
+    // 每步最多回收的页数和占用的时间
+    static const int VacuumPagesPerStep = 256;
+    static const int StepBudgetMs = 50;
+    
+    static qint64 pragmaValue(const QSqlDatabase &db, const QString &name);
+    bool convert();
+    bool vacuumStep();
+    void check();
+    
+    QSqlDatabase m_db;
+    Phase m_phase;
+    qint64 m_startPageCount;
+    qint64 m_pageSize;
+    NoteMaintenanceReport m_report;
+};
+
+#endif // NOTEMAINTENANCE_H
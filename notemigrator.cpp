@@ -0,0 +1,494 @@
+#include "notemigrator.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+// 迁移列表，按版本号升序排列，只能在末尾追加
+// 版本1~5对应引入迁移之前的建表代码，全部使用IF NOT EXISTS等可重复执行的写法：
+// 旧版本的数据库user_version为0，其中可能已有任意一部分表和列。
+const NoteMigrator::Migration NoteMigrator::s_migrations[] = {
+    {1, "便签表和文本投影列", &NoteMigrator::createNotesTable, false, nullptr},
+    {2, "图片引用", &NoteMigrator::createImageTables, false, nullptr},
+    {3, "变更日志", &NoteMigrator::createChangeJournal, false, nullptr},
+    {4, "全文索引", &NoteMigrator::createSearchIndex, true, &NoteMigrator::hasSearchIndex},
+    {5, "子串索引", &NoteMigrator::createSubstringIndex, true, &NoteMigrator::hasSubstringIndex},
+    {6, "图片释放时间", &NoteMigrator::addImageReleaseTime, false, nullptr},
+    {7, "搜索索引补齐进度", &NoteMigrator::createIndexBackfillTable, false, nullptr}
+};
+
+int NoteMigrator::latestVersion()
+{
+    return s_migrations[sizeof(s_migrations) / sizeof(s_migrations[0]) - 1].version;
+}
+
+int NoteMigrator::schemaVersion(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA user_version") || !query.next()) {
+        return -1;
+    }
+    
+    return query.value(0).toInt();
+}
+
+bool NoteMigrator::migrate(QSqlDatabase &db)
+{
+    int version = schemaVersion(db);
+    if (version < 0) {
+        qDebug() << "无法读取数据库版本";
+        return false;
+    }
+    
+    // 较新版本程序创建的数据库：已有的表和列都兼容，只是不认识新增的部分
+    if (version > latestVersion()) {
+        qDebug() << "数据库版本" << version << "高于程序支持的版本" << latestVersion();
+        return true;
+    }
+    
+    for (const Migration &migration : s_migrations) {
+        if (migration.version <= version) {
+            // 之前被跳过的可选迁移（例如当时的SQLite缺少FTS5）重新尝试，版本号不变
+            if (migration.optional && migration.isApplied && !migration.isApplied(db)) {
+                qDebug() << "重新尝试数据库迁移: " << migration.version << migration.description;
+                if (!runMigration(db, migration, false)) {
+                    return false;
+                }
+            }
+            continue;
+        }
+        
+        if (!runMigration(db, migration, true)) {
+            return false;
+        }
+        
+        version = migration.version;
+    }
+    
+    return true;
+}
+
+// 在一个事务中执行迁移，updateVersion为true时连同版本号一起提交
+// 失败时整体撤销，下次启动从该迁移重新开始；可选的迁移失败时跳过，返回true
+bool NoteMigrator::runMigration(QSqlDatabase &db, const Migration &migration, bool updateVersion)
+{
+    if (!db.transaction()) {
+        qDebug() << "迁移无法开始事务: " << db.lastError().text();
+        return false;
+    }
+    
+    if (!migration.apply(db)) {
+        db.rollback();
+        
+        if (!migration.optional) {
+            qDebug() << "数据库迁移失败: " << migration.version << migration.description;
+            return false;
+        }
+        
+        // 可选的迁移（依赖SQLite编译选项的索引）失败时跳过，功能在运行时按表是否存在判断
+        qDebug() << "跳过数据库迁移: " << migration.version << migration.description;
+        if (!updateVersion) {
+            return true;
+        }
+        if (!db.transaction()) {
+            return false;
+        }
+    }
+    
+    QSqlQuery query(db);
+    if (updateVersion && !query.exec(QString("PRAGMA user_version = %1").arg(migration.version))) {
+        qDebug() << "更新数据库版本失败: " << query.lastError().text();
+        db.rollback();
+        return false;
+    }
+    
+    if (!db.commit()) {
+        qDebug() << "迁移提交失败: " << db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    
+    return true;
+}
+
+bool NoteMigrator::hasSearchIndex(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    return query.exec("SELECT sql FROM sqlite_master WHERE type = 'table' AND name = 'notes_fts'") &&
+           query.next() && query.value(0).toString().contains("search_body");
+}
+
+bool NoteMigrator::hasSubstringIndex(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    return query.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'notes_trigram'") &&
+           query.next();
+}
+
+bool NoteMigrator::createNotesTable(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    
+    // 创建笔记表
+    QString sql = "CREATE TABLE IF NOT EXISTS notes ("
+                  "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                  "title TEXT, "
+                  "content TEXT, "
+                  "content_dict INTEGER, "
+                  "plain_text TEXT, "
+                  "first_line TEXT, "
+                  "snippet TEXT, "
+                  "char_count INTEGER, "
+                  "word_count INTEGER, "
+                  "search_title TEXT, "
+                  "search_body TEXT, "
+                  "create_time DATETIME, "
+                  "update_time DATETIME)";
+    
+    if (!query.exec(sql)) {
+        qDebug() << "创建表失败: " << query.lastError().text();
+        return false;
+    }
+    
+    // 内容压缩使用的文档头字典
+    if (!query.exec("CREATE TABLE IF NOT EXISTS content_dictionaries ("
+                    "id INTEGER PRIMARY KEY, "
+                    "preamble TEXT NOT NULL UNIQUE)")) {
+        qDebug() << "创建字典表失败: " << query.lastError().text();
+        return false;
+    }
+    
+    // 旧版本的数据库缺少文本投影列和分词列
+    static const char *const addedColumns[][2] = {
+        {"content_dict", "INTEGER"},
+        {"plain_text", "TEXT"},
+        {"first_line", "TEXT"},
+        {"snippet", "TEXT"},
+        {"char_count", "INTEGER"},
+        {"word_count", "INTEGER"},
+        {"search_title", "TEXT"},
+        {"search_body", "TEXT"}
+    };
+    for (const auto &column : addedColumns) {
+        if (!hasColumn(db, "notes", column[0]) &&
+            !query.exec(QString("ALTER TABLE notes ADD COLUMN %1 %2").arg(column[0], column[1]))) {
+            qDebug() << "添加列失败: " << column[0] << query.lastError().text();
+            return false;
+        }
+    }
+    
+    // 列表按更新时间倒序分页读取，索引隐含rowid，可直接满足 ORDER BY update_time, id
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_notes_update_time ON notes(update_time)")) {
+        qDebug() << "创建索引失败: " << query.lastError().text();
+        return false;
+    }
+    
+    return true;
+}
+
+// 图片引用
+// image_refs记录每个便签引用了哪些图片（按哈希，见NoteImageStore），
+// image_blobs.ref_count由触发器维护，等于引用该图片的便签数；删除便签时其引用随之删除。
+// 引用数为0的图片不会立即删除，由后台回收（释放时间见版本6）。
+bool NoteMigrator::createImageTables(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    
+    static const char *const statements[] = {
+        "CREATE TABLE IF NOT EXISTS image_blobs ("
+        "hash TEXT PRIMARY KEY, "
+        "ref_count INTEGER NOT NULL DEFAULT 0)",
+        
+        "CREATE TABLE IF NOT EXISTS image_refs ("
+        "note_id INTEGER NOT NULL, "
+        "hash TEXT NOT NULL, "
+        "PRIMARY KEY (note_id, hash)) WITHOUT ROWID",
+        
+        "CREATE INDEX IF NOT EXISTS idx_image_refs_hash ON image_refs(hash)",
+        
+        "CREATE TRIGGER IF NOT EXISTS image_refs_insert AFTER INSERT ON image_refs BEGIN "
+        "INSERT OR IGNORE INTO image_blobs (hash) VALUES (new.hash); "
+        "UPDATE image_blobs SET ref_count = ref_count + 1 WHERE hash = new.hash; "
+        "END",
+        
+        "CREATE TRIGGER IF NOT EXISTS image_refs_delete AFTER DELETE ON image_refs BEGIN "
+        "UPDATE image_blobs SET ref_count = ref_count - 1 WHERE hash = old.hash; "
+        "END",
+        
+        "CREATE TRIGGER IF NOT EXISTS notes_image_refs_delete AFTER DELETE ON notes BEGIN "
+        "DELETE FROM image_refs WHERE note_id = old.id; "
+        "END"
+    };
+    
+    for (const char *statement : statements) {
+        if (!query.exec(QString::fromLatin1(statement))) {
+            qDebug() << "创建图片引用表失败: " << query.lastError().text();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// 变更日志
+// note_changes由notes上的触发器追加，序号使用AUTOINCREMENT，删除旧记录后也不会重复使用。
+// change_type：0 插入，1 修改，2 删除（墓碑）。只有用户保存（update_time变化）才记为修改，
+// 补齐投影列、压缩内容等内部改写不会产生记录。
+// 为避免日志随自动保存无限增长，同一便签较早的修改记录在追加新记录时删除，
+// 删除便签时其之前的记录都被墓碑取代；序号仍然单调递增，changesSince()的结果不受影响。
+bool NoteMigrator::createChangeJournal(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    
+    static const char *const statements[] = {
+        "CREATE TABLE IF NOT EXISTS note_changes ("
+        "seq INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "note_id INTEGER NOT NULL, "
+        "change_type INTEGER NOT NULL, "
+        "change_time TEXT NOT NULL)",
+        
+        "CREATE INDEX IF NOT EXISTS idx_note_changes_note ON note_changes(note_id)",
+        
+        "CREATE TRIGGER IF NOT EXISTS note_changes_insert AFTER INSERT ON notes BEGIN "
+        "INSERT INTO note_changes (note_id, change_type, change_time) "
+        "VALUES (new.id, 0, strftime('%Y-%m-%dT%H:%M:%fZ', 'now')); "
+        "END",
+        
+        "CREATE TRIGGER IF NOT EXISTS note_changes_update AFTER UPDATE OF update_time ON notes BEGIN "
+        "DELETE FROM note_changes WHERE note_id = new.id AND change_type = 1; "
+        "INSERT INTO note_changes (note_id, change_type, change_time) "
+        "VALUES (new.id, 1, strftime('%Y-%m-%dT%H:%M:%fZ', 'now')); "
+        "END",
+        
+        "CREATE TRIGGER IF NOT EXISTS note_changes_delete AFTER DELETE ON notes BEGIN "
+        "DELETE FROM note_changes WHERE note_id = old.id; "
+        "INSERT INTO note_changes (note_id, change_type, change_time) "
+        "VALUES (old.id, 2, strftime('%Y-%m-%dT%H:%M:%fZ', 'now')); "
+        "END"
+    };
+    
+    for (const char *statement : statements) {
+        if (!query.exec(QString::fromLatin1(statement))) {
+            qDebug() << "创建变更日志失败: " << query.lastError().text();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// 全文索引
+// notes_fts是以notes为外部内容的FTS5表，只保存索引，不重复保存文本；由触发器与notes保持同步。
+// 索引建立在分词列search_title/search_body上：内容来自纯文本，搜索不会匹配到HTML标签和属性；
+// 中日韩文字已拆成双字词（见NoteText::toSearchText），中文查询同样走索引。
+// 新建的索引为空，已有便签由NoteBackfill分批加入（见beginIndexBackfill）；
+// 触发器只维护已经补齐的便签，ID大于补齐进度的便签留给补齐处理。
+bool NoteMigrator::createSearchIndex(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    
+    QString existingSql;
+    if (query.exec("SELECT sql FROM sqlite_master WHERE type = 'table' AND name = 'notes_fts'") && query.next()) {
+        existingSql = query.value(0).toString();
+    }
+    query.finish();
+    
+    // 最初的全文索引建立在title/plain_text列上（未切分中日韩文字），删除后按分词列重建
+    bool exists = !existingSql.isEmpty();
+    if (exists && !existingSql.contains("search_body")) {
+        static const char *const dropStatements[] = {
+            "DROP TRIGGER IF EXISTS notes_fts_insert",
+            "DROP TRIGGER IF EXISTS notes_fts_delete",
+            "DROP TRIGGER IF EXISTS notes_fts_update",
+            "DROP TABLE IF EXISTS notes_fts"
+        };
+        for (const char *statement : dropStatements) {
+            if (!query.exec(QString::fromLatin1(statement))) {
+                qDebug() << "删除旧的全文索引失败: " << query.lastError().text();
+                return false;
+            }
+        }
+        exists = false;
+    }
+    
+    // 新建的索引先登记补齐进度，触发器依赖进度表
+    if (!exists && !beginIndexBackfill(db, "notes_fts")) {
+        return false;
+    }
+    
+    static const char *const statements[] = {
+        "CREATE VIRTUAL TABLE IF NOT EXISTS notes_fts USING fts5("
+        "search_title, search_body, content='notes', content_rowid='id')",
+        
+        "CREATE TRIGGER IF NOT EXISTS notes_fts_insert AFTER INSERT ON notes "
+        "WHEN NOT EXISTS (SELECT 1 FROM search_index_backfill WHERE name = 'notes_fts' AND new.id > last_id) BEGIN "
+        "INSERT INTO notes_fts(rowid, search_title, search_body) "
+        "VALUES (new.id, new.search_title, new.search_body); "
+        "END",
+        
+        "CREATE TRIGGER IF NOT EXISTS notes_fts_delete AFTER DELETE ON notes "
+        "WHEN NOT EXISTS (SELECT 1 FROM search_index_backfill WHERE name = 'notes_fts' AND old.id > last_id) BEGIN "
+        "INSERT INTO notes_fts(notes_fts, rowid, search_title, search_body) "
+        "VALUES ('delete', old.id, old.search_title, old.search_body); "
+        "END",
+        
+        "CREATE TRIGGER IF NOT EXISTS notes_fts_update AFTER UPDATE OF search_title, search_body ON notes "
+        "WHEN NOT EXISTS (SELECT 1 FROM search_index_backfill WHERE name = 'notes_fts' AND new.id > last_id) BEGIN "
+        "INSERT INTO notes_fts(notes_fts, rowid, search_title, search_body) "
+        "VALUES ('delete', old.id, old.search_title, old.search_body); "
+        "INSERT INTO notes_fts(rowid, search_title, search_body) "
+        "VALUES (new.id, new.search_title, new.search_body); "
+        "END"
+    };
+    
+    for (const char *statement : statements) {
+        if (!query.exec(QString::fromLatin1(statement))) {
+            qDebug() << "全文索引不可用，搜索将逐行匹配: " << query.lastError().text();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// 图片释放时间
+// image_blobs.release_time记录引用数降为0的时间（UTC），图片回收从此时开始计算宽限期；
+// 重新被引用时清空。保存便签时先删除再登记全部引用，同一事务中设置的释放时间随即被清空。
+// 旧版本按便签分目录保存的图片也以相对路径为键登记在这两个表中（见NoteImageStore::referenceKey）。
+bool NoteMigrator::addImageReleaseTime(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    
+    if (!hasColumn(db, "image_blobs", "release_time") &&
+        !query.exec("ALTER TABLE image_blobs ADD COLUMN release_time TEXT")) {
+        qDebug() << "添加列失败: release_time" << query.lastError().text();
+        return false;
+    }
+    
+    static const char *const statements[] = {
+        "DROP TRIGGER IF EXISTS image_refs_insert",
+        "DROP TRIGGER IF EXISTS image_refs_delete",
+        
+        "CREATE TRIGGER image_refs_insert AFTER INSERT ON image_refs BEGIN "
+        "INSERT OR IGNORE INTO image_blobs (hash) VALUES (new.hash); "
+        "UPDATE image_blobs SET ref_count = ref_count + 1, release_time = NULL WHERE hash = new.hash; "
+        "END",
+        
+        // SET中的ref_count是更新前的值
+        "CREATE TRIGGER image_refs_delete AFTER DELETE ON image_refs BEGIN "
+        "UPDATE image_blobs SET ref_count = ref_count - 1, "
+        "release_time = CASE WHEN ref_count <= 1 THEN strftime('%Y-%m-%dT%H:%M:%fZ', 'now') ELSE release_time END "
+        "WHERE hash = old.hash; "
+        "END",
+        
+        // 已经不被引用的图片从升级时开始计算宽限期
+        "UPDATE image_blobs SET release_time = strftime('%Y-%m-%dT%H:%M:%fZ', 'now') "
+        "WHERE ref_count <= 0 AND release_time IS NULL"
+    };
+    
+    for (const char *statement : statements) {
+        if (!query.exec(QString::fromLatin1(statement))) {
+            qDebug() << "记录图片释放时间失败: " << query.lastError().text();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// 子串索引
+// notes_trigram使用FTS5的trigram分词器，把标题和纯文本切成连续的三字符片段，
+// 任意位置的子串（例如产品编号的一部分）都可以通过索引查找，不再逐行LIKE。
+bool NoteMigrator::createSubstringIndex(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    
+    bool exists = query.exec("SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'notes_trigram'") &&
+                  query.next();
+    query.finish();
+    
+    if (!exists && !beginIndexBackfill(db, "notes_trigram")) {
+        return false;
+    }
+    
+    static const char *const statements[] = {
+        "CREATE VIRTUAL TABLE IF NOT EXISTS notes_trigram USING fts5("
+        "title, plain_text, content='notes', content_rowid='id', tokenize='trigram')",
+        
+        "CREATE TRIGGER IF NOT EXISTS notes_trigram_insert AFTER INSERT ON notes "
+        "WHEN NOT EXISTS (SELECT 1 FROM search_index_backfill WHERE name = 'notes_trigram' AND new.id > last_id) BEGIN "
+        "INSERT INTO notes_trigram(rowid, title, plain_text) VALUES (new.id, new.title, new.plain_text); "
+        "END",
+        
+        "CREATE TRIGGER IF NOT EXISTS notes_trigram_delete AFTER DELETE ON notes "
+        "WHEN NOT EXISTS (SELECT 1 FROM search_index_backfill WHERE name = 'notes_trigram' AND old.id > last_id) BEGIN "
+        "INSERT INTO notes_trigram(notes_trigram, rowid, title, plain_text) "
+        "VALUES ('delete', old.id, old.title, old.plain_text); "
+        "END",
+        
+        "CREATE TRIGGER IF NOT EXISTS notes_trigram_update AFTER UPDATE OF title, plain_text ON notes "
+        "WHEN NOT EXISTS (SELECT 1 FROM search_index_backfill WHERE name = 'notes_trigram' AND new.id > last_id) BEGIN "
+        "INSERT INTO notes_trigram(notes_trigram, rowid, title, plain_text) "
+        "VALUES ('delete', old.id, old.title, old.plain_text); "
+        "INSERT INTO notes_trigram(rowid, title, plain_text) VALUES (new.id, new.title, new.plain_text); "
+        "END"
+    };
+    
+    for (const char *statement : statements) {
+        if (!query.exec(QString::fromLatin1(statement))) {
+            // SQLite 3.34之前没有trigram分词器
+            qDebug() << "子串索引不可用: " << query.lastError().text();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// 搜索索引补齐进度
+// search_index_backfill每行对应一个尚未补齐的搜索索引，last_id为已加入索引的最大便签ID，
+// 补齐完成后删除该行。迁移4、5新建索引时先于本迁移执行，因此同样会创建此表。
+bool NoteMigrator::createIndexBackfillTable(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    if (!query.exec("CREATE TABLE IF NOT EXISTS search_index_backfill ("
+                    "name TEXT PRIMARY KEY, "
+                    "last_id INTEGER NOT NULL)")) {
+        qDebug() << "创建搜索索引补齐进度表失败: " << query.lastError().text();
+        return false;
+    }
+    
+    return true;
+}
+
+bool NoteMigrator::beginIndexBackfill(QSqlDatabase &db, const QString &name)
+{
+    if (!createIndexBackfillTable(db)) {
+        return false;
+    }
+    
+    QSqlQuery query(db);
+    query.prepare("INSERT OR REPLACE INTO search_index_backfill (name, last_id) VALUES (?, 0)");
+    query.addBindValue(name);
+    if (!query.exec()) {
+        qDebug() << "登记搜索索引补齐失败: " << name << query.lastError().text();
+        return false;
+    }
+    
+    return true;
+}
+
+bool NoteMigrator::hasColumn(QSqlDatabase &db, const QString &table, const QString &column)
+{
+    QSqlQuery query(db);
+    if (!query.exec(QString("PRAGMA table_info(%1)").arg(table))) {
+        return false;
+    }
+    
+    while (query.next()) {
+        if (query.value(1).toString() == column) {
+            return true;
+        }
+    }
+    
+    return false;
+}
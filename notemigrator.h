@@ -0,0 +1,52 @@
+#ifndef NOTEMIGRATOR_H
+#define NOTEMIGRATOR_H
+
+#include <QSqlDatabase>
+
+// 数据库结构迁移
+// 数据库结构的版本号保存在PRAGMA user_version中，每个迁移把结构从上一版本升级到自己的版本。
+// 打开数据库时按版本号顺序执行尚未执行的迁移，每个迁移及版本号的更新在同一个事务中提交。
+// 可选的迁移失败时版本号照常前进，之后每次打开时检查其结果是否存在，不存在则重试。
+// 迁移只做结构变更（建表、加列、建索引），不逐行改写已有数据；
+// 需要逐行计算的补齐（文本投影、搜索索引、内容压缩）由NoteBackfill在写线程中分批完成，不阻塞启动。
+// 增加迁移：在s_migrations末尾追加一项，版本号加1。
+class NoteMigrator
+{
+public:
+    // 执行全部未执行的迁移，必需的迁移失败时返回false
+    static bool migrate(QSqlDatabase &db);
+    
+    // 数据库当前的结构版本，读取失败时返回-1
+    static int schemaVersion(QSqlDatabase &db);
+    // 程序支持的最新结构版本
+    static int latestVersion();
+    
+    // 可选索引是否可用（SQLite缺少FTS5或trigram分词器时迁移会被跳过）
+    static bool hasSearchIndex(QSqlDatabase &db);
+    static bool hasSubstringIndex(QSqlDatabase &db);
+
+private:
+    struct Migration {
+        int version;
+        const char *description;
+        bool (*apply)(QSqlDatabase &db);
+        bool optional;  // 失败时跳过而不是中止
+        bool (*isApplied)(QSqlDatabase &db);  // 可选迁移：结果是否存在，跳过的迁移在之后打开时重试
+    };
+    
+    static const Migration s_migrations[];
+    
+    static bool runMigration(QSqlDatabase &db, const Migration &migration, bool updateVersion);
+    static bool createNotesTable(QSqlDatabase &db);
+    static bool createImageTables(QSqlDatabase &db);
+    static bool createChangeJournal(QSqlDatabase &db);
+    static bool createSearchIndex(QSqlDatabase &db);
+    static bool createSubstringIndex(QSqlDatabase &db);
+    static bool addImageReleaseTime(QSqlDatabase &db);
+    static bool createIndexBackfillTable(QSqlDatabase &db);
+    // 新建的空搜索索引登记补齐进度，由NoteBackfill分批加入已有便签
+    static bool beginIndexBackfill(QSqlDatabase &db, const QString &name);
+    static bool hasColumn(QSqlDatabase &db, const QString &table, const QString &column);
+};
+
+#endif // NOTEMIGRATOR_H
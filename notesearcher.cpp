@@ -0,0 +1,51 @@
+#include "notesearcher.h"
+#include "notedatabase.h"
+
+NoteSearcher::NoteSearcher(NoteDatabase *database, QObject *parent)
+    : QObject(parent)
+    , m_database(database)
+    , m_generation(0)
+{
+    qRegisterMetaType<QList<NoteSummary>>("QList<NoteSummary>");
+}
+
+quint64 NoteSearcher::startSearch(const QString &keyword)
+{
+    quint64 generation = cancel();
+    QMetaObject::invokeMethod(this, "search", Qt::QueuedConnection,
+                              Q_ARG(quint64, generation), Q_ARG(QString, keyword));
+    return generation;
+}
+
+quint64 NoteSearcher::cancel()
+{
+    return m_generation.fetchAndAddOrdered(1) + 1;
+}
+
+void NoteSearcher::search(quint64 generation, const QString &keyword)
+{
+    // 排队期间已被更新的搜索取代
+    if (!isCurrent(generation)) {
+        return;
+    }
+    
+    // 每批结果发出前检查编号，被取代后不再继续读取
+    bool completed = m_database->searchNotes(keyword, [this, generation](const QList<NoteSummary> &batch) {
+        if (!isCurrent(generation)) {
+            return false;
+        }
+        emit resultsReady(generation, batch);
+        return true;
+    });
+    
+    // 搜索失败时同样结束，接收者按已收到的结果显示
+    if (!completed && !isCurrent(generation)) {
+        return;
+    }
+    emit searchFinished(generation);
+}
+
+bool NoteSearcher::isCurrent(quint64 generation) const
+{
+    return m_generation.loadAcquire() == generation;
+}
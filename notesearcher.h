@@ -0,0 +1,43 @@
+#ifndef NOTESEARCHER_H
+#define NOTESEARCHER_H
+
+#include <QObject>
+#include <QAtomicInteger>
+#include <QList>
+#include "note.h"
+
+class NoteDatabase;
+
+// 后台搜索
+// 对象需移动到独立线程中运行，搜索使用连接池中该线程的读连接，不阻塞界面。
+// 每次搜索有一个递增的编号：开始新的搜索或取消时编号增加，
+// 旧的搜索在排队时直接跳过，执行中的搜索在下一批结果之前停止，已发出的旧结果由接收者按编号丢弃。
+// 结果分批发出，第一批到达时即可显示。
+class NoteSearcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NoteSearcher(NoteDatabase *database, QObject *parent = nullptr);
+    
+    // 取消之前的搜索并在搜索线程中开始新的搜索，返回其编号（可在任意线程调用）
+    quint64 startSearch(const QString &keyword);
+    // 取消之前的搜索，返回新的编号，之后不再有旧搜索的结果
+    quint64 cancel();
+
+signals:
+    // 一批搜索结果，按相关度顺序排在之前的批次之后
+    void resultsReady(quint64 generation, const QList<NoteSummary> &batch);
+    // 搜索结束（被取消的搜索不会发出）
+    void searchFinished(quint64 generation);
+
+private slots:
+    void search(quint64 generation, const QString &keyword);
+
+private:
+    bool isCurrent(quint64 generation) const;
+    
+    NoteDatabase *m_database;
+    QAtomicInteger<quint64> m_generation;
+};
+
+#endif // NOTESEARCHER_H
@@ -0,0 +1,47 @@
+#include "notestatementcache.h"
+#include <QSqlError>
+#include <QDebug>
+
+NoteStatementCache::NoteStatementCache()
+{
+}
+
+NoteStatementCache::~NoteStatementCache()
+{
+    clear();
+}
+
+void NoteStatementCache::setDatabase(const QSqlDatabase &db)
+{
+    clear();
+    m_db = db;
+}
+
+QSqlQuery *NoteStatementCache::statement(const QString &sql)
+{
+    QSqlQuery *query = m_statements.value(sql, nullptr);
+    
+    if (query) {
+        // 释放上一次的结果集，避免长时间占用读快照
+        query->finish();
+        return query;
+    }
+    
+    query = new QSqlQuery(m_db);
+    query->setForwardOnly(true);
+    if (!query->prepare(sql)) {
+        qDebug() << "预编译语句失败: " << query->lastError().text() << sql;
+        delete query;
+        return nullptr;
+    }
+    
+    m_statements.insert(sql, query);
+    return query;
+}
+
+void NoteStatementCache::clear()
+{
+    qDeleteAll(m_statements);
+    m_statements.clear();
+    m_db = QSqlDatabase();
+}
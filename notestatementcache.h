@@ -0,0 +1,34 @@
+#ifndef NOTESTATEMENTCACHE_H
+#define NOTESTATEMENTCACHE_H
+
+#include <QHash>
+#include <QString>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+
+// 预编译语句缓存
+// 每个数据库连接持有一份，同一条SQL只prepare一次，之后重复使用。
+// 取出的语句已重置：上一次的结果集已释放，参数需要重新绑定。
+// 连接关闭前必须先调用clear()，否则连接会被仍在使用的语句占用。
+class NoteStatementCache
+{
+public:
+    NoteStatementCache();
+    ~NoteStatementCache();
+    
+    void setDatabase(const QSqlDatabase &db);
+    
+    // 获取指定SQL的语句，首次使用时prepare；prepare失败返回nullptr
+    QSqlQuery *statement(const QString &sql);
+    
+    // 释放全部语句
+    void clear();
+
+private:
+    Q_DISABLE_COPY(NoteStatementCache)
+    
+    QSqlDatabase m_db;
+    QHash<QString, QSqlQuery*> m_statements;
+};
+
+#endif // NOTESTATEMENTCACHE_H
@@ -0,0 +1,326 @@
+#include "notetext.h"
+#include <QRegularExpression>
+#include <QStringList>
+
+QString NoteText::toPlainText(const QString &html)
+{
+    if (!html.contains("<html>") && !html.contains("<body>")) {
+        return html;
+    }
+    
+    static const QRegularExpression headPattern("<head>.*</head>",
+        QRegularExpression::DotMatchesEverythingOption | QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression blockEndPattern("</(p|div|li|h[1-6]|tr|pre|blockquote)>|<br\\s*/?>",
+        QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression tagPattern("<[^>]*>");
+    
+    QString text = html;
+    
+    // 样式表等头部内容不属于正文
+    text.remove(headPattern);
+    
+    // HTML源码中的换行只是排版，真正的换行来自段落和<br>
+    text.replace('\r', ' ');
+    text.replace('\n', ' ');
+    text.replace(blockEndPattern, "\n");
+    
+    // 去掉其余标签（包括图片）后再解码实体，避免把正文中的"&lt;"当成标签
+    text.remove(tagPattern);
+    text = decodeEntities(text);
+    
+    // 逐行去掉首尾空白，丢弃开头和结尾的空行
+    QStringList lines = text.split('\n');
+    for (QString &line : lines) {
+        line = line.trimmed();
+    }
+    while (!lines.isEmpty() && lines.first().isEmpty()) {
+        lines.removeFirst();
+    }
+    while (!lines.isEmpty() && lines.last().isEmpty()) {
+        lines.removeLast();
+    }
+    
+    return lines.join('\n');
+}
+
+NoteText::Projection NoteText::project(const QString &title, const QString &content)
+{
+    Projection projection;
+    projection.plainText = toPlainText(content);
+    
+    // 纯文本已去掉开头的空行
+    projection.firstLine = projection.plainText.section('\n', 0, 0).left(FirstLineLength);
+    projection.snippet = projection.plainText.simplified().left(SnippetLength);
+    
+    for (const QChar &ch : std::as_const(projection.plainText)) {
+        if (!ch.isSpace()) {
+            ++projection.charCount;
+        }
+    }
+    projection.wordCount = countWords(projection.plainText);
+    
+    projection.searchTitle = toSearchText(title);
+    projection.searchBody = toSearchText(projection.plainText);
+    
+    // 空文本保存为''而不是NULL：NULL表示尚未计算，会在每次启动时被重新补齐
+    for (QString *text : {&projection.plainText, &projection.firstLine, &projection.snippet,
+                          &projection.searchTitle, &projection.searchBody}) {
+        if (text->isNull()) {
+            *text = QString("");
+        }
+    }
+    
+    return projection;
+}
+
+int NoteText::countWords(const QString &plainText)
+{
+    // 汉字、英文单词、连续数字串
+    static const QRegularExpression wordPattern("[\u4e00-\u9fa5]|[A-Za-z]+(?:'[A-Za-z]+)?|\\d+");
+    
+    int count = 0;
+    QRegularExpressionMatchIterator it = wordPattern.globalMatch(plainText);
+    while (it.hasNext()) {
+        it.next();
+        ++count;
+    }
+    return count;
+}
+
+QString NoteText::decodeEntities(const QString &text)
+{
+    static const QRegularExpression entityPattern("&(#[0-9]+|#[xX][0-9a-fA-F]+|[a-zA-Z]+);");
+    
+    if (!text.contains('&')) {
+        return text;
+    }
+    
+    QString result;
+    result.reserve(text.size());
+    
+    qsizetype last = 0;
+    QRegularExpressionMatchIterator it = entityPattern.globalMatch(text);
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        result += QStringView(text).mid(last, match.capturedStart() - last);
+        last = match.capturedEnd();
+        
+        QString name = match.captured(1);
+        if (name.startsWith('#')) {
+            // 数字实体
+            bool ok = false;
+            char32_t code = (name.size() > 1 && (name.at(1) == 'x' || name.at(1) == 'X'))
+                ? name.mid(2).toUInt(&ok, 16)
+                : name.mid(1).toUInt(&ok, 10);
+            if (ok && code > 0 && code <= 0x10FFFF) {
+                result += QString::fromUcs4(&code, 1);
+            } else {
+                result += match.captured(0);
+            }
+        } else if (name == "amp") {
+            result += '&';
+        } else if (name == "lt") {
+            result += '<';
+        } else if (name == "gt") {
+            result += '>';
+        } else if (name == "quot") {
+            result += '"';
+        } else if (name == "apos") {
+            result += '\'';
+        } else if (name == "nbsp") {
+            result += ' ';
+        } else {
+            // 未知实体原样保留
+            result += match.captured(0);
+        }
+    }
+    result += QStringView(text).mid(last);
+    
+    return result;
+}
+
+bool NoteText::isCjk(uint ucs4)
+{
+    switch (QChar::script(ucs4)) {
+    case QChar::Script_Han:
+    case QChar::Script_Hiragana:
+    case QChar::Script_Katakana:
+    case QChar::Script_Hangul:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void NoteText::appendUcs4(QString &out, uint ucs4)
+{
+    if (QChar::requiresSurrogates(ucs4)) {
+        out += QChar(QChar::highSurrogate(ucs4));
+        out += QChar(QChar::lowSurrogate(ucs4));
+    } else {
+        out += QChar(ucs4);
+    }
+}
+
+QString NoteText::toSearchText(const QString &text)
+{
+    const QList<uint> chars = text.toUcs4();
+    
+    QString result;
+    result.reserve(text.size() * 2);
+    
+    qsizetype i = 0;
+    while (i < chars.size()) {
+        if (!isCjk(chars.at(i))) {
+            appendUcs4(result, chars.at(i));
+            ++i;
+            continue;
+        }
+        
+        // 找到这一段连续的中日韩文字
+        qsizetype end = i;
+        while (end < chars.size() && isCjk(chars.at(end))) {
+            ++end;
+        }
+        
+        // 重叠的双字词，再补上最后一个单字，使单字查询也能按前缀命中
+        result += ' ';
+        for (qsizetype k = i; k + 1 < end; ++k) {
+            appendUcs4(result, chars.at(k));
+            appendUcs4(result, chars.at(k + 1));
+            result += ' ';
+        }
+        appendUcs4(result, chars.at(end - 1));
+        result += ' ';
+        
+        i = end;
+    }
+    
+    return result;
+}
+
+QString NoteText::quotePhrase(const QString &phrase)
+{
+    QString escaped = phrase;
+    escaped.replace('"', "\"\"");
+    return '"' + escaped + '"';
+}
+
+QString NoteText::toMatchExpression(const QString &keyword)
+{
+    QStringList terms;
+    
+    const QStringList words = keyword.split(' ', Qt::SkipEmptyParts);
+    for (const QString &word : words) {
+        const QList<uint> chars = word.toUcs4();
+        
+        qsizetype i = 0;
+        while (i < chars.size()) {
+            bool cjk = isCjk(chars.at(i));
+            qsizetype end = i;
+            while (end < chars.size() && isCjk(chars.at(end)) == cjk) {
+                ++end;
+            }
+            
+            if (cjk) {
+                if (end - i == 1) {
+                    // 单个字：匹配以它开头的双字词或段末的单字
+                    QString single;
+                    appendUcs4(single, chars.at(i));
+                    terms.append(quotePhrase(single) + '*');
+                } else {
+                    // 连续的双字词组成短语，要求在原文中相邻
+                    QStringList bigrams;
+                    for (qsizetype k = i; k + 1 < end; ++k) {
+                        QString bigram;
+                        appendUcs4(bigram, chars.at(k));
+                        appendUcs4(bigram, chars.at(k + 1));
+                        bigrams.append(bigram);
+                    }
+                    terms.append(quotePhrase(bigrams.join(' ')));
+                }
+            } else {
+                // 只含标点的部分不产生任何词，跳过，否则会使整个查询无结果
+                QString part;
+                bool searchable = false;
+                for (qsizetype k = i; k < end; ++k) {
+                    appendUcs4(part, chars.at(k));
+                    searchable = searchable || QChar::isLetterOrNumber(chars.at(k));
+                }
+                if (searchable) {
+                    terms.append(quotePhrase(part) + '*');
+                }
+            }
+            
+            i = end;
+        }
+    }
+    
+    return terms.join(' ');
+}
+
+QString NoteText::toSubstringMatchExpression(const QString &keyword)
+{
+    QStringList terms;
+    
+    const QStringList words = keyword.split(' ', Qt::SkipEmptyParts);
+    for (const QString &word : words) {
+        if (word.toUcs4().size() < 3) {
+            return QString();
+        }
+        terms.append(quotePhrase(word));
+    }
+    
+    return terms.join(' ');
+}
+
+QString NoteText::highlightSnippet(const QString &plainText, const QString &keyword,
+                                   int length, QChar begin, QChar end)
+{
+    const QStringList words = keyword.split(' ', Qt::SkipEmptyParts);
+    
+    // 以第一个命中的位置为中心截取
+    qsizetype first = -1;
+    for (const QString &word : words) {
+        qsizetype pos = plainText.indexOf(word, 0, Qt::CaseInsensitive);
+        if (pos >= 0 && (first < 0 || pos < first)) {
+            first = pos;
+        }
+    }
+    
+    qsizetype start = first > length / 4 ? first - length / 4 : 0;
+    QString window = plainText.mid(start, length);
+    window.replace('\n', ' ');
+    
+    // 标记片段中所有命中的文本
+    QString result;
+    qsizetype pos = 0;
+    while (pos < window.size()) {
+        qsizetype matchLength = 0;
+        for (const QString &word : words) {
+            if (word.size() > matchLength &&
+                QStringView(window).mid(pos).startsWith(word, Qt::CaseInsensitive)) {
+                matchLength = word.size();
+            }
+        }
+        
+        if (matchLength > 0) {
+            result += begin;
+            result += QStringView(window).mid(pos, matchLength);
+            result += end;
+            pos += matchLength;
+        } else {
+            result += window.at(pos);
+            ++pos;
+        }
+    }
+    
+    if (start > 0) {
+        result.prepend(QString::fromUtf8("…"));
+    }
+    if (start + length < plainText.size()) {
+        result += QString::fromUtf8("…");
+    }
+    
+    return result;
+}
@@ -0,0 +1,69 @@
+#ifndef NOTETEXT_H
+#define NOTETEXT_H
+
+#include <QString>
+
+#include <QChar>
+#include <QStringList>
+
+// 便签文本工具
+// 从便签的HTML内容中提取纯文本，并生成全文索引使用的分词文本。
+// 不依赖QTextDocument，可以在写线程中调用。
+class NoteText
+{
+public:
+    // 保存时从便签计算的文本投影，与HTML内容一起存入数据库，读取时不再解析HTML
+    struct Projection
+    {
+        QString plainText;      // 纯文本
+        QString firstLine;      // 第一行，无标题便签用作显示标题
+        QString snippet;        // 内容摘要
+        int charCount = 0;      // 字符数（不含空白）
+        int wordCount = 0;      // 字数，规则同编辑窗口的字数统计
+        QString searchTitle;    // 标题的分词文本
+        QString searchBody;     // 正文的分词文本
+    };
+    
+    // 计算便签的文本投影
+    static Projection project(const QString &title, const QString &content);
+    
+    // 统计字数：每个汉字、每个英文单词、每个连续数字串各算一个字
+    static int countWords(const QString &plainText);
+    
+    // 第一行和摘要的最大长度
+    static const int FirstLineLength = 200;
+    static const int SnippetLength = 80;
+    
+    // 将HTML转换为纯文本：段落和换行转为换行符，去掉标签、样式和图片，解码字符实体
+    // 内容不是HTML时原样返回
+    static QString toPlainText(const QString &html);
+    
+    // 生成写入全文索引的文本
+    // SQLite的分词器把连续的汉字当作一个词，这里把每段中日韩文字拆成重叠的双字词，
+    // 并在末尾补上最后一个单字（"学中文" -> "学中 中文 文"），其余文字保持不变，
+    // 仍由unicode61分词器按单词切分。
+    static QString toSearchText(const QString &text);
+    
+    // 把用户输入转换为FTS5查询表达式，与toSearchText的切分方式对应：
+    // - 中日韩文字按双字词组成短语（"中文本" -> "中文 文本"），单个字按前缀匹配；
+    // - 其余部分作为带引号的短语按前缀匹配；
+    // - 各部分之间为AND。引号内的内容不会被当作FTS5语法。
+    // 输入中没有可检索的文字时返回空字符串。
+    static QString toMatchExpression(const QString &keyword);
+    
+    // 把用户输入转换为三元组索引的查询表达式，每个词作为短语在文本任意位置匹配
+    // 三元组索引无法匹配少于3个字符的词，这时返回空字符串
+    static QString toSubstringMatchExpression(const QString &keyword);
+    
+    // 在纯文本中截取包含关键词的片段，命中的文本用begin/end标记
+    static QString highlightSnippet(const QString &plainText, const QString &keyword,
+                                    int length, QChar begin, QChar end);
+
+private:
+    static QString decodeEntities(const QString &text);
+    static bool isCjk(uint ucs4);
+    static void appendUcs4(QString &out, uint ucs4);
+    static QString quotePhrase(const QString &phrase);
+};
+
+#endif // NOTETEXT_H
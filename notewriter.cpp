@@ -0,0 +1,392 @@
+#include "notewriter.h"
+#include "notedatabase.h"
+#include <QMutexLocker>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+const char *const NoteWriter::ConnectionName = "SimpleNote.writer";
+
+namespace {
+// 图片回收的记录，键见NoteImageStore::referenceKey
+const QString SqlInsertReleasedImage = QStringLiteral(
+    "INSERT OR IGNORE INTO image_blobs (hash, ref_count, release_time) "
+    "VALUES (?, 0, strftime('%Y-%m-%dT%H:%M:%fZ', 'now'))");
+const QString SqlMarkReleasedImage = QStringLiteral(
+    "UPDATE image_blobs SET release_time = strftime('%Y-%m-%dT%H:%M:%fZ', 'now') "
+    "WHERE hash = ? AND ref_count <= 0 AND release_time IS NULL");
+const QString SqlDeleteRemovedImage = QStringLiteral(
+    "DELETE FROM image_blobs WHERE hash = ? AND ref_count <= 0");
+}
+
+NoteWriter::NoteWriter(const QString &dbPath, QObject *parent)
+    : QObject(parent)
+    , m_dbPath(dbPath)
+    , m_coalesceTimer(new QTimer(this))
+    , m_checkpointTimer(new QTimer(this))
+    , m_maintenanceTimer(new QTimer(this))
+    , m_backfillTimer(new QTimer(this))
+    , m_nextRequestId(1)
+    , m_nextNewNoteKey(-1)
+    , m_flushScheduled(false)
+{
+    // 计时器作为子对象，随本对象一起移动到写线程
+    m_coalesceTimer->setSingleShot(true);
+    m_coalesceTimer->setInterval(CoalesceDelayMs);
+    connect(m_coalesceTimer, &QTimer::timeout, this, &NoteWriter::processQueue);
+    
+    // 空闲检查点：最后一批写入后一段时间内没有新的写入，就把WAL合并回主文件
+    m_checkpointTimer->setSingleShot(true);
+    m_checkpointTimer->setInterval(IdleCheckpointDelayMs);
+    connect(m_checkpointTimer, &QTimer::timeout, this, &NoteWriter::checkpoint);
+    
+    // 维护分步执行，步与步之间回到事件循环，排队的保存可以插在中间写入
+    m_maintenanceTimer->setInterval(MaintenanceStepDelayMs);
+    connect(m_maintenanceTimer, &QTimer::timeout, this, &NoteWriter::runMaintenanceStep);
+    
+    // 数据补齐同样分批执行
+    m_backfillTimer->setInterval(BackfillStepDelayMs);
+    connect(m_backfillTimer, &QTimer::timeout, this, &NoteWriter::runBackfillStep);
+}
+
+NoteWriter::~NoteWriter()
+{
+    closeConnection();
+}
+
+bool NoteWriter::openConnection()
+{
+    if (m_db.isOpen()) {
+        return true;
+    }
+    
+    // 连接只在写线程中创建和使用
+    m_db = QSqlDatabase::addDatabase("QSQLITE", ConnectionName);
+    m_db.setDatabaseName(m_dbPath);
+    
+    if (!m_db.open()) {
+        qDebug() << "写线程无法打开数据库: " << m_db.lastError().text();
+        return false;
+    }
+    
+    m_statements.setDatabase(m_db);
+    
+    if (!NoteDatabase::applyStorageProfile(m_db)) {
+        return false;
+    }
+    
+    // 在后台补齐已有便签的数据（升级后的首次启动）
+    m_backfill.begin(m_db, &m_statements);
+    m_backfillTimer->start();
+    
+    return true;
+}
+
+void NoteWriter::closeConnection()
+{
+    if (!QSqlDatabase::contains(ConnectionName)) {
+        return;
+    }
+    
+    m_coalesceTimer->stop();
+    m_checkpointTimer->stop();
+    m_maintenanceTimer->stop();
+    m_maintenance.cancel();
+    m_backfillTimer->stop();
+    m_backfill.cancel();
+    m_statements.clear();
+    m_db.close();
+    m_db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(ConnectionName);
+}
+
+quint64 NoteWriter::enqueue(const Note &note, quint64 insertRequestId)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    quint64 requestId = m_nextRequestId++;
+    Note queued = note;
+    
+    // 已有便签按ID合并；新便签沿用同一插入的临时键，没有时为独立的插入请求
+    qint64 key = note.id();
+    if (key <= 0) {
+        key = m_insertKeys.value(insertRequestId, 0);
+        if (insertRequestId == 0 || key == 0) {
+            key = m_nextNewNoteKey--;
+        }
+        m_insertKeys.insert(requestId, key);
+        
+        // 插入已经完成，调用者还没收到ID
+        auto inserted = m_insertedIds.constFind(key);
+        if (inserted != m_insertedIds.constEnd()) {
+            queued.setId(inserted.value());
+        }
+    }
+    
+    PendingSave &pending = m_pending[key];
+    pending.requestIds.append(requestId);
+    pending.note = queued;
+    
+    // 队列从空变为非空时，通知写线程开始计时
+    if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(m_coalesceTimer, "start", Qt::QueuedConnection);
+    }
+    
+    return requestId;
+}
+
+void NoteWriter::forgetInsert(quint64 requestId)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    auto found = m_insertKeys.find(requestId);
+    if (found == m_insertKeys.end()) {
+        return;
+    }
+    
+    qint64 key = found.value();
+    m_insertKeys.erase(found);
+    
+    // 同一便签还有未完成的请求
+    for (qint64 other : std::as_const(m_insertKeys)) {
+        if (other == key) {
+            return;
+        }
+    }
+    
+    // 同一临时键的请求都已完成，调用者已经拿到ID，之后的保存按ID合并
+    m_insertedIds.remove(key);
+}
+
+qint64 NoteWriter::pendingKey(int noteId) const
+{
+    if (m_pending.contains(noteId)) {
+        return noteId;
+    }
+    
+    // 已插入、仍以临时键排队的新便签
+    for (auto it = m_insertedIds.cbegin(); it != m_insertedIds.cend(); ++it) {
+        if (it.value() == noteId && m_pending.contains(it.key())) {
+            return it.key();
+        }
+    }
+    
+    return noteId;
+}
+
+void NoteWriter::discard(int noteId)
+{
+    PendingSave dropped;
+    {
+        QMutexLocker locker(&m_mutex);
+        dropped = m_pending.take(pendingKey(noteId));
+    }
+    
+    if (dropped.requestIds.isEmpty()) {
+        return;
+    }
+    
+    // 等待这些请求的调用者同样会收到通知；与正常完成一样在写线程中发出
+    QMetaObject::invokeMethod(this, [this, dropped]() {
+        for (quint64 requestId : dropped.requestIds) {
+            emit saveFinished(requestId, dropped.note, false);
+        }
+    }, Qt::QueuedConnection);
+}
+
+bool NoteWriter::pendingNote(int noteId, Note &note)
+{
+    QMutexLocker locker(&m_mutex);
+    
+    // 排队中的版本比正在写入的版本新
+    auto pending = m_pending.constFind(pendingKey(noteId));
+    if (pending != m_pending.constEnd()) {
+        note = pending->note;
+        return true;
+    }
+    
+    auto writing = m_writing.constFind(noteId);
+    if (writing != m_writing.constEnd()) {
+        note = writing.value();
+        return true;
+    }
+    
+    return false;
+}
+
+void NoteWriter::processQueue()
+{
+    QMap<qint64, PendingSave> batch;
+    {
+        QMutexLocker locker(&m_mutex);
+        batch.swap(m_pending);
+        m_flushScheduled = false;
+        
+        // 插入完成后排队的保存改为更新已插入的便签
+        // 提交并通知之前，读取仍然返回这一批中的版本
+        for (auto it = batch.begin(); it != batch.end(); ++it) {
+            PendingSave &pending = it.value();
+            if (it.key() < 0 && m_insertedIds.contains(it.key())) {
+                pending.note.setId(m_insertedIds.value(it.key()));
+            }
+            if (pending.note.id() > 0) {
+                m_writing.insert(pending.note.id(), pending.note);
+            }
+        }
+    }
+    
+    m_coalesceTimer->stop();
+    
+    if (batch.isEmpty()) {
+        return;
+    }
+    
+    if (!m_db.isOpen() && !openConnection()) {
+        for (const PendingSave &pending : batch) {
+            for (quint64 requestId : pending.requestIds) {
+                emit saveFinished(requestId, pending.note, false);
+            }
+        }
+        clearWriting();
+        return;
+    }
+    
+    // 整批请求在一个事务中写入，只需一次磁盘同步
+    QList<Note> notes;
+    for (const PendingSave &pending : batch) {
+        notes.append(pending.note);
+    }
+    
+    QList<bool> results;
+    NoteChangeBatch changes;
+    NoteDatabase::writeNotes(m_db, m_statements, notes, results, &changes);
+    
+    // 先记录新便签的ID，调用者收到完成通知前的后续保存不会再次插入
+    {
+        QMutexLocker locker(&m_mutex);
+        int index = 0;
+        for (auto it = batch.cbegin(); it != batch.cend(); ++it, ++index) {
+            if (it.key() < 0 && results.at(index) && notes.at(index).id() > 0) {
+                m_insertedIds.insert(it.key(), notes.at(index).id());
+            }
+        }
+    }
+    
+    int index = 0;
+    for (auto it = batch.cbegin(); it != batch.cend(); ++it, ++index) {
+        for (quint64 requestId : it->requestIds) {
+            emit saveFinished(requestId, notes.at(index), results.at(index));
+        }
+    }
+    
+    if (!changes.isEmpty()) {
+        emit notesChanged(changes);
+    }
+    
+    // 缓存已在完成通知中失效，之后的读取从数据库取得新版本
+    clearWriting();
+    
+    m_checkpointTimer->start();
+}
+
+void NoteWriter::clearWriting()
+{
+    QMutexLocker locker(&m_mutex);
+    m_writing.clear();
+}
+
+void NoteWriter::checkpoint()
+{
+    if (!m_db.isOpen()) {
+        return;
+    }
+    
+    // 被动检查点不等待读者，不会阻塞其他连接
+    QSqlQuery query(m_db);
+    if (!query.exec("PRAGMA wal_checkpoint(PASSIVE)")) {
+        qDebug() << "空闲检查点失败: " << query.lastError().text();
+    }
+    
+    // 空闲时开始一轮维护
+    bool due = !m_sinceMaintenance.isValid() || m_sinceMaintenance.elapsed() >= MaintenanceIntervalMs;
+    if (due && !m_maintenance.isRunning() && !m_backfill.isRunning()) {
+        m_maintenance.begin(m_db);
+        m_maintenanceTimer->start();
+    }
+}
+
+void NoteWriter::runBackfillStep()
+{
+    if (!m_db.isOpen() || !m_backfill.step()) {
+        m_backfillTimer->stop();
+        m_backfill.cancel();
+    }
+}
+
+void NoteWriter::runMaintenanceStep()
+{
+    if (!m_db.isOpen()) {
+        m_maintenanceTimer->stop();
+        m_maintenance.cancel();
+        return;
+    }
+    
+    if (m_maintenance.step()) {
+        return;
+    }
+    
+    m_maintenanceTimer->stop();
+    m_sinceMaintenance.start();
+    
+    const NoteMaintenanceReport &report = m_maintenance.report();
+    qDebug() << "数据库维护完成: 回收" << report.reclaimedBytes << "字节,"
+             << "切换回收模式耗时" << report.convertMs << "ms,"
+             << "回收耗时" << report.vacuumMs << "ms, 统计耗时" << report.analyzeMs << "ms,"
+             << "检查耗时" << report.checkMs << "ms";
+    if (report.compactionNeeded) {
+        qDebug() << "数据库较大，空闲页需要压缩后才能回收: " << report.freeBytes << "字节";
+    }
+    if (!report.integrityOk) {
+        qDebug() << "数据库完整性检查未通过: " << report.integrityMessage;
+    }
+    
+    emit maintenanceFinished(report);
+}
+
+void NoteWriter::recordImageSweep(const QStringList &released, const QStringList &removed)
+{
+    if (!m_db.isOpen()) {
+        return;
+    }
+    
+    bool inTransaction = m_db.transaction();
+    
+    for (const QString &key : released) {
+        for (const QString &sql : {SqlInsertReleasedImage, SqlMarkReleasedImage}) {
+            QSqlQuery *query = m_statements.statement(sql);
+            if (query) {
+                query->bindValue(0, key);
+                if (!query->exec()) {
+                    qDebug() << "记录图片释放时间失败: " << query->lastError().text();
+                }
+            }
+        }
+    }
+    
+    // 期间又被引用的图片保留记录
+    for (const QString &key : removed) {
+        QSqlQuery *query = m_statements.statement(SqlDeleteRemovedImage);
+        if (query) {
+            query->bindValue(0, key);
+            if (!query->exec()) {
+                qDebug() << "删除图片记录失败: " << query->lastError().text();
+            }
+        }
+    }
+    
+    if (inTransaction && !m_db.commit()) {
+        qDebug() << "图片回收记录提交失败: " << m_db.lastError().text();
+        m_db.rollback();
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef NOTEWRITER_H
+#define NOTEWRITER_H
+
+#include <QObject>
+#include <QMap>
+#include <QList>
+#include <QMutex>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include "note.h"
+#include "notestatementcache.h"
+#include "notemaintenance.h"
+#include "notebackfill.h"
+
+// 便签写线程
+// 保存请求先进入队列，由独立线程批量写入：同一便签的多次保存会被合并，
+// 多个窗口的保存合并为一个事务，界面线程不再等待磁盘同步。
+// 对象需移动到独立线程中运行，enqueue()/discard()可在任意线程调用。
+class NoteWriter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NoteWriter(const QString &dbPath, QObject *parent = nullptr);
+    ~NoteWriter();
+    
+    // 入队一次保存请求，返回请求编号
+    // 新便签的后续保存传入之前某次保存的请求编号，与尚未完成的插入合并，插入完成后改为更新该便签
+    quint64 enqueue(const Note &note, quint64 insertRequestId = 0);
+    
+    // 新便签的保存请求完成并已通知调用者后调用，不再需要按请求编号合并
+    void forgetInsert(quint64 requestId);
+    
+    // 丢弃某个便签尚未写入的保存请求（删除便签前调用），被丢弃的请求以失败结束
+    void discard(int noteId);
+    
+    // 便签尚未提交的最新版本（排队中或正在写入），没有时返回false（可在任意线程调用）
+    bool pendingNote(int noteId, Note &note);
+    
+    // 写线程的连接名称
+    static const char *const ConnectionName;
+
+public slots:
+    // 在写线程中打开/关闭连接
+    bool openConnection();
+    void closeConnection();
+    
+    // 立即写入队列中的全部请求
+    void processQueue();
+    
+    // 被动检查点，写线程空闲时执行；距上次维护足够久时接着开始一轮维护
+    void checkpoint();
+    
+    // 执行一步数据库维护
+    void runMaintenanceStep();
+    
+    // 补齐一批已有便签的数据
+    void runBackfillStep();
+    
+    // 记录一批图片回收的结果（见NoteImageCollector）
+    // released为首次发现未被引用的图片，从现在开始计算宽限期；removed为文件已被删除的图片
+    void recordImageSweep(const QStringList &released, const QStringList &removed);
+
+signals:
+    // 保存完成（在写线程中发出，以排队方式传递给接收者）
+    void saveFinished(quint64 requestId, const Note &note, bool success);
+    
+    // 一个事务提交后发出，包含其中全部已写入的便签
+    void notesChanged(const NoteChangeBatch &changes);
+    
+    // 一轮维护结束
+    void maintenanceFinished(const NoteMaintenanceReport &report);
+
+private:
+    void clearWriting();
+    
+    // 便签在m_pending中的键（需持有m_mutex）
+    qint64 pendingKey(int noteId) const;
+    
+    struct PendingSave {
+        QList<quint64> requestIds; // 被合并的所有请求编号
+        Note note;
+    };
+    
+    // 合并窗口：首个请求到达后等待的时间，期间到达的请求写入同一个事务
+    static const int CoalesceDelayMs = 150;
+    // 最后一批写入后多久执行空闲检查点
+    static const int IdleCheckpointDelayMs = 30000;
+    // 两轮维护之间至少间隔的时间，以及维护步骤之间的间隔
+    static const qint64 MaintenanceIntervalMs = 6 * 60 * 60 * 1000;
+    static const int MaintenanceStepDelayMs = 20;
+    // 数据补齐批次之间的间隔
+    static const int BackfillStepDelayMs = 20;
+    
+    QString m_dbPath;
+    QSqlDatabase m_db;
+    NoteStatementCache m_statements;
+    QTimer *m_coalesceTimer;
+    QTimer *m_checkpointTimer;
+    QTimer *m_maintenanceTimer;
+    NoteMaintenance m_maintenance;
+    QTimer *m_backfillTimer;
+    NoteBackfill m_backfill;
+    QElapsedTimer m_sinceMaintenance;  // 本次运行尚未维护过时无效
+    
+    QMutex m_mutex;
+    QMap<qint64, PendingSave> m_pending; // 键：便签ID，新便签使用负数临时键
+    QMap<int, Note> m_writing;           // 正在写入、尚未通知完成的已有便签
+    QMap<quint64, qint64> m_insertKeys;  // 新便签的请求编号到临时键
+    QMap<qint64, int> m_insertedIds;     // 已插入的新便签：临时键到分配的ID
+    quint64 m_nextRequestId;
+    qint64 m_nextNewNoteKey;
+    bool m_flushScheduled;
+};
+
+#endif // NOTEWRITER_H
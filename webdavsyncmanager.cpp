@@ -1,4 +1,6 @@
 #include "webdavsyncmanager.h"
+#include "noteimagestore.h"
+#include "noteimagecollector.h"
 #include <QDebug>
 #include <QApplication>
 #include <QStandardPaths>
@@ -6,6 +8,7 @@
 #include <QEventLoop>
 #include <QFileInfo>
 #include <QDirIterator>
+#include <QSet>
 
 WebDAVSyncManager::WebDAVSyncManager(QObject *parent)
     : QObject(parent)
@@ -463,20 +466,42 @@ bool WebDAVSyncManager::syncDatabase()
     
     if (m_syncDirection == TwoWay || m_syncDirection == LocalToRemote) {
         // 上传数据库
-        QDateTime localTime = dbInfo.lastModified();
+        // 先写入排队的保存；WAL模式下检查点之前最近的保存只在-wal文件中，主文件的修改时间可能是旧的
+        m_database->flushPendingWrites();
+        QDateTime localTime = QFileInfo(dbPath).lastModified();
+        QFileInfo walInfo(dbPath + "-wal");
+        if (walInfo.exists() && walInfo.lastModified() > localTime) {
+            localTime = walInfo.lastModified();
+        }
         
-        if (!remoteExists || shouldUploadFile(dbPath, remoteExists ? m_remoteFiles[remoteDbName] : QDateTime())) {
-            // 上传数据库前先关闭数据库连接
-            bool wasOpen = m_database->isOpen();
-            if (wasOpen) {
-                m_database->close();
+        if (!remoteExists || shouldUploadFile(localTime, remoteExists ? m_remoteFiles[remoteDbName] : QDateTime())) {
+            // 上传数据库的在线快照，数据库保持打开，编辑和保存不受影响
+            QString snapshotPath = QDir::tempPath() + "/SimpleNote_sync_snapshot.db";
+            bool snapshotOk = false;
+            
+            // 等待后台线程完成快照
+            QEventLoop snapshotLoop;
+            connect(m_database, &NoteDatabase::snapshotFinished, &snapshotLoop,
+                    [&snapshotLoop, &snapshotOk, snapshotPath](const QString &path, bool success) {
+                if (path == snapshotPath) {
+                    snapshotOk = success;
+                    snapshotLoop.quit();
+                }
+            });
+            if (m_database->startSnapshot(snapshotPath)) {
+                snapshotLoop.exec();
+            }
+            
+            if (!snapshotOk) {
+                m_lastError = tr("无法创建数据库快照");
+                return false;
             }
             
-            // 上传数据库
-            QFile dbFile(dbPath);
+            QFile dbFile(snapshotPath);
             if (dbFile.open(QIODevice::ReadOnly)) {
                 QByteArray data = dbFile.readAll();
                 dbFile.close();
+                QFile::remove(snapshotPath);
                 
                 QNetworkReply *reply = m_webdav->put(remoteDbName, data);
                 
@@ -488,29 +513,15 @@ bool WebDAVSyncManager::syncDatabase()
                 if (reply->error() != QNetworkReply::NoError) {
                     m_lastError = tr("数据库上传失败: ") + reply->errorString();
                     reply->deleteLater();
-                    
-                    // 重新打开数据库
-                    if (wasOpen) {
-                        m_database->open();
-                    }
                     return false;
                 }
                 
                 reply->deleteLater();
             } else {
                 m_lastError = tr("无法打开本地数据库文件");
-                
-                // 重新打开数据库
-                if (wasOpen) {
-                    m_database->open();
-                }
+                QFile::remove(snapshotPath);
                 return false;
             }
-            
-            // 重新打开数据库
-            if (wasOpen) {
-                m_database->open();
-            }
         }
     } else if (m_syncDirection == RemoteToLocal && remoteExists) {
         // 下载远程数据库
@@ -536,6 +547,10 @@ bool WebDAVSyncManager::syncDatabase()
             m_database->close();
         }
         
+        // 删除旧数据库残留的WAL文件，避免被应用到下载的数据库上
+        QFile::remove(dbPath + "-wal");
+        QFile::remove(dbPath + "-shm");
+        
         // 保存下载的数据库
         QFile dbFile(dbPath);
         if (dbFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
@@ -594,9 +609,10 @@ bool WebDAVSyncManager::syncImages()
                 
                 // 同步图片
                 if (m_syncDirection == TwoWay || m_syncDirection == LocalToRemote) {
-                    // 上传图片
+                    // 上传图片；图片存储中的文件按内容命名、不会改变，远程已有即无需比较时间
                     if (!m_remoteFiles.contains(relativePath) || 
-                        shouldUploadFile(localPath, m_remoteFiles[relativePath])) {
+                        (!NoteImageStore::isBlobPath(relativePath) &&
+                         shouldUploadFile(localPath, m_remoteFiles[relativePath]))) {
                         m_pendingUploads.append(relativePath);
                     }
                 }
@@ -604,14 +620,37 @@ bool WebDAVSyncManager::syncImages()
         }
     }
     
+    // 本地已回收的图片：远程副本一并删除，不再下载回来
+    QSet<QString> collected;
+    QStringList handled;
+    foreach (const QString &imagePath, NoteImageCollector::collectedImages()) {
+        QString remotePath = m_remoteFolder + "images/" + imagePath;
+        
+        if (dir.exists(imagePath) || !m_remoteFiles.contains(remotePath)) {
+            // 之后又生成了同名文件，或远程已经没有该文件，记录不再需要
+            handled.append(imagePath);
+        } else if (m_syncDirection == RemoteToLocal) {
+            // 只下载的模式不修改远程，只跳过下载
+            collected.insert(remotePath);
+        } else if (deleteRemoteFile(remotePath)) {
+            m_remoteFiles.remove(remotePath);
+            handled.append(imagePath);
+        } else {
+            // 删除失败，下次同步再试
+            collected.insert(remotePath);
+        }
+    }
+    NoteImageCollector::forgetCollectedImages(handled);
+    
     // 处理远程图片下载
     if (m_syncDirection == TwoWay || m_syncDirection == RemoteToLocal) {
         foreach (const QString &remotePath, m_remoteFiles.keys()) {
-            if (remotePath.startsWith(m_remoteFolder + "images/")) {
+            if (remotePath.startsWith(m_remoteFolder + "images/") && !collected.contains(remotePath)) {
                 QString localPath = localFilePath(remotePath);
                 
                 if (!QFile::exists(localPath) || 
-                    shouldDownloadFile(remotePath, localFiles.value(remotePath))) {
+                    (!NoteImageStore::isBlobPath(remotePath) &&
+                     shouldDownloadFile(remotePath, localFiles.value(remotePath)))) {
                     // 确保本地目录存在
                     QFileInfo fileInfo(localPath);
                     QDir().mkpath(fileInfo.absolutePath());
@@ -677,6 +716,26 @@ void WebDAVSyncManager::createRemoteDirectory(const QString &path)
     reply->deleteLater();
 }
 
+bool WebDAVSyncManager::deleteRemoteFile(const QString &remotePath)
+{
+    QNetworkReply *reply = m_webdav->remove(remotePath);
+    
+    // 等待操作完成
+    QEventLoop loop;
+    connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
+    loop.exec();
+    
+    // 远程文件已不存在也算删除成功
+    bool success = reply->error() == QNetworkReply::NoError ||
+                   reply->error() == QNetworkReply::ContentNotFoundError;
+    if (!success) {
+        qDebug() << "删除远程文件失败: " << remotePath << reply->errorString();
+    }
+    
+    reply->deleteLater();
+    return success;
+}
+
 bool WebDAVSyncManager::performSync(SyncDirection direction)
 {
     m_currentProgress = 30;
@@ -733,14 +792,16 @@ QString WebDAVSyncManager::remoteFilePath(const QString &localPath)
 }
 
 bool WebDAVSyncManager::shouldUploadFile(const QString &localPath, const QDateTime &remoteModified)
+{
+    return shouldUploadFile(QFileInfo(localPath).lastModified(), remoteModified);
+}
+
+bool WebDAVSyncManager::shouldUploadFile(const QDateTime &localModified, const QDateTime &remoteModified)
 {
     if (remoteModified.isNull()) {
         return true;  // 远程文件不存在
     }
     
-    QFileInfo info(localPath);
-    QDateTime localModified = info.lastModified();
-    
     // 考虑时间差异
     QDateTime adjustedRemoteTime = remoteModified.addSecs(m_timeOffset);
     
@@ -121,6 +121,9 @@ private:
     // 创建远程目录
     void createRemoteDirectory(const QString &path);
     
+    // 删除远程文件
+    bool deleteRemoteFile(const QString &remotePath);
+    
     // 执行特定方向的同步
     bool performSync(SyncDirection direction);
     
@@ -131,6 +134,7 @@ private:
     QString localFilePath(const QString &remotePath);
     QString remoteFilePath(const QString &localPath);
     bool shouldUploadFile(const QString &localPath, const QDateTime &remoteModified);
+    bool shouldUploadFile(const QDateTime &localModified, const QDateTime &remoteModified);
     bool shouldDownloadFile(const QString &remotePath, const QDateTime &localModified);
     
     // 文件上传和下载